@@ -0,0 +1,821 @@
+#ifndef GRFX_H
+#define GRFX_H
+
+// libgrafx: 2D occluder scenes and a ray tracer that writes ray segments into caller buffers.
+// Only needs SDL's core (types, memory, threads), never a window or renderer.
+
+#pragma region Include
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_rect.h>
+#include <SDL3/SDL_pixels.h>
+#include <SDL3/SDL_surface.h>
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_mutex.h>
+#include <SDL3/SDL_thread.h>
+#include <SDL3/SDL_cpuinfo.h>
+#include <SDL3/SDL_error.h>
+
+#pragma endregion Include
+
+#pragma region Macro
+
+#define M_PI 3.14159265358979323846
+#define RAY_EPSILON 0.001f
+#define RAY_POOL_SIZE 65536
+#define MIN_RAY_ENERGY 0.02f
+#define GLASS_IOR 1.5f
+
+#define GRFX_HIT_NONE 0
+#define GRFX_HIT_BLOCK 1
+#define GRFX_HIT_SEGMENT 2
+#define GRFX_HIT_CIRCLE 3
+#define GRFX_HIT_MASK 4
+
+#define STATS_MAX_BLOCKS 64
+#define STATS_MAX_THREADS 64
+#define STATS_HISTORY 4096
+#define MAX_WORKERS 64
+
+#define RASTER_TILE 64
+
+#define BVH_LEAF_SIZE 4
+#define BVH_MIN_BLOCKS 16
+#define BVH_STACK_SIZE 64
+#define BVH_REBUILD_RATIO 1.3f
+
+#define FIXED_MAX_BLOCKS 8
+#define HIT_CACHE_SLOTS 8
+
+#define SDF_CELL 4.0f
+#define SDF_MAX_DIST 64.0f
+#define SDF_MAX_STEPS 512
+#define SDF_KIND_SHIFT 24
+
+#define GI_PROBES_X 200
+#define GI_MAX_CASCADES 6
+#define GI_ALBEDO 0.6f
+#define GI_PASSES 8
+
+#define RING_MAGIC "GRFXRNG1"
+#define RING_VERSION 2
+#define RING_HEADER_SIZE 64
+
+#define BLOOM_SCALE 4
+#define BLOOM_RADIUS 8
+#define BLOOM_THRESHOLD 0.15f
+#define BLOOM_INTENSITY 1.0f
+
+#define HEATMAP_CELL 8
+
+#define LIGHT_CACHE_CELL 16
+
+#define CACHE_MAGIC "GRFXACC1"
+#define CACHE_VERSION 1
+#define CACHE_ALIGN 64
+
+// Work counters, build with -DGRFX_NO_STATS to compile them out
+#ifdef GRFX_NO_STATS
+#define GRFX_STAT_ADD(field, n)
+#define GRFX_STAT_BLOCK_HIT(id)
+#else
+#define GRFX_STAT_ADD(field, n) (grfx_stats->field += (n))
+#define GRFX_STAT_BLOCK_HIT(id) (grfx_stats->hits_per_block[(id) < STATS_MAX_BLOCKS ? (id) : STATS_MAX_BLOCKS - 1]++)
+#endif
+
+// Count every heap allocation by replacing malloc on glibc, build with -DGRFX_NO_MALLOC_HOOK to keep libc's
+#if defined(__GLIBC__) && !defined(GRFX_NO_MALLOC_HOOK)
+#define GRFX_MALLOC_HOOK
+#endif
+
+#pragma endregion Macro
+
+#pragma region Declare
+
+// Line segment occluders, packed SoA so the intersection kernel can load 4 at a time.
+// Convex polygons are stored here as their edges.
+struct GRFX_Segments {
+    float *x1;
+    float *y1;
+    float *x2;
+    float *y2;
+    int count;
+    int capacity;
+};
+
+// Circle occluders, packed SoA
+struct GRFX_Circles {
+    float *x;
+    float *y;
+    float *r;
+    int count;
+    int capacity;
+};
+
+// Convex polygons, each one a range of edges in GRFX_Segments
+struct GRFX_Polygons {
+    int *first;
+    int *count;
+    int num;
+    int capacity;
+};
+
+// A node of the block BVH. Leaves hold count blocks starting at indices[first],
+// inner nodes have count 0 and their children at nodes[first] and nodes[first + 1].
+struct GRFX_BVH_Node {
+    float x_min;
+    float y_min;
+    float x_max;
+    float y_max;
+    int first;
+    int count;
+};
+
+// Bounding volume hierarchy over the scene's blocks, refit as they move and rebuilt when it gets too loose.
+// Mapped arrays live in a cache file mapping, a rebuild moves them to the heap.
+struct GRFX_BVH {
+    struct GRFX_BVH_Node *nodes;
+    int *indices;
+    int num_nodes;
+    int num_blocks;
+    int capacity;
+    float build_cost;
+    float cost;
+    bool mapped;
+};
+
+// Signed distance field of a scene's occluders, sampled at the centers of cell x cell squares.
+// The occluders touching cell c are cell_items[cell_start[c]] up to cell_start[c + 1], packed as
+// kind << SDF_KIND_SHIFT | id. When mapped, dist and the cell lists live in a cache file mapping
+// and move to the heap on the first update.
+struct GRFX_SDF {
+    int width;
+    int height;
+    float cell;
+    float *dist;
+    int *cell_start;
+    int *cell_items;
+    int item_capacity;
+    float *row_out;
+    float *row_in;
+    Uint8 *scratch;
+    int scratch_threads;
+    SDL_FRect dirty;
+    bool dirty_all;
+    bool has_dirty;
+    bool mapped;
+};
+
+// Occupancy bitmap, cell (cx, cy) covers cell x cell units from (x + cx * cell, y + cy * cell) and is set
+// when bit cx % 64 of word bits[cy * pitch + cx / 64] is. Mask hits use cy * width + cx as their id.
+struct GRFX_Mask {
+    Uint64 *bits;
+    int width;
+    int height;
+    int pitch;
+    float x;
+    float y;
+    float cell;
+};
+
+// One level of radiance probes, width x height of them spacing units apart. Every probe looks along dirs
+// evenly spread directions, dir_x[j] and dir_y[j], over the interval from start to end units away.
+// Interval j of probe (px, py) is at index (py * width + px) * dirs + j.
+struct GRFX_GI_Cascade {
+    int width;
+    int height;
+    int dirs;
+    float spacing;
+    float start;
+    float end;
+    float *dir_x;
+    float *dir_y;
+    float *t_hit;
+    float *radiance;
+};
+
+// Diffuse global illumination over the domain from radiance cascades. Each cascade has half the probes of the
+// one below along each side, four times the directions and intervals four times longer, and finds the light
+// beyond its intervals in the cascade above. t_hit keeps where every interval meets an occluder, so only
+// intervals crossing an edit are marched again. Surfaces reflect GI_ALBEDO of the fluence arriving next to
+// them the pass before, so bounced light builds up over GI_PASSES passes after every change.
+struct GRFX_GI {
+    SDL_FRect domain;
+    int num_cascades;
+    struct GRFX_GI_Cascade cascades[GI_MAX_CASCADES];
+    float *fluence;
+    float *next;
+    float light_x;
+    float light_y;
+    float light_r;
+    int passes;
+    SDL_FRect dirty;
+    bool dirty_all;
+    bool has_dirty;
+};
+
+// Start of a shared-memory frame ring, followed by num_slots slots of slot_size bytes each.
+// frames counts the frames published so far, frame f goes into slot f % num_slots.
+struct GRFX_Ring_Header {
+    char magic[8];
+    Uint32 version;
+    Uint32 num_slots;
+    Uint32 slot_size;
+    Uint32 max_segments;
+    Uint32 max_width;
+    Uint32 max_height;
+    SDL_AtomicU32 frames;
+};
+
+// One frame in the ring: RING_HEADER_SIZE bytes of this, then max_segments ray segments, then the image as
+// height rows of pitch bytes. seq is 2 * frame + 1 while the writer fills the slot and 2 * frame + 2 once
+// it is published, so readers check it before and after reading and never hold the writer up.
+struct GRFX_Ring_Slot {
+    SDL_AtomicU32 seq;
+    Uint32 frame;
+    Uint64 time_ns;
+    Uint32 num_segments;
+    Uint32 width;
+    Uint32 height;
+    Uint32 pitch;
+    Uint32 format;
+};
+
+// A mapping of a ring, created by the one writer or opened by any number of readers
+struct GRFX_Ring {
+    struct GRFX_Ring_Header *header;
+    size_t size;
+    bool owner;
+    char name[64];
+    void *handle;
+};
+
+// Glow for a width x height RGBA32 image: its bright part is averaged down BLOOM_SCALE times into floats,
+// blurred with a separable Gaussian reaching BLOOM_RADIUS low-res pixels and added back on top
+struct GRFX_Bloom {
+    int width;
+    int height;
+    int low_width;
+    int low_height;
+    float threshold;
+    float intensity;
+    float weights[BLOOM_RADIUS + 1];
+    Sint16 lerp[BLOOM_SCALE];
+    float *bright;
+    float *blur;
+    Sint16 *scratch;
+    int scratch_threads;
+    Uint8 *pixels;
+    int pitch;
+};
+
+// Tracer cost over an image in square cells of cell pixels, summed from the costs of the segments crossing each one
+struct GRFX_Heatmap {
+    int width;
+    int height;
+    int cell;
+    float *cost;
+    float max;
+};
+
+// Light paths baked on a grid of width x height points, cell units apart from the corner of bounds.
+// The segments traced from point i are segments[first[i]] up to segments[first[i + 1]], ray by ray.
+// key is what the scene hashed to when they were traced.
+struct GRFX_Light_Cache {
+    SDL_FRect bounds;
+    int width;
+    int height;
+    float cell;
+    int num_rays;
+    int depth;
+    Uint64 key;
+    int *first;
+    struct GRFX_Ray_Segment *segments;
+    int num_segments;
+};
+
+// Start of an acceleration structure cache file. Sections are found by their offset from the start
+// of the file, so it works wherever it is mapped. hash is GRFX_Hash_Scene of the scene it was built for.
+struct GRFX_Cache_Header {
+    char magic[8];
+    Uint32 version;
+    Uint32 byte_order;
+    Uint64 hash;
+    Uint64 size;
+    float cell;
+    Sint32 sdf_width;
+    Sint32 sdf_height;
+    Sint32 sdf_items;
+    Uint64 dist_offset;
+    Uint64 cell_start_offset;
+    Uint64 cell_items_offset;
+    Sint32 bvh_nodes;
+    Sint32 bvh_blocks;
+    float bvh_build_cost;
+    float bvh_cost;
+    Uint64 bvh_nodes_offset;
+    Uint64 bvh_indices_offset;
+};
+
+// Everything rays can hit, inside a width x height box whose walls reflect, and the light.
+// cache is the mapping of the cache file the BVH or distance field came from, if any.
+struct GRFX_Scene {
+    float width;
+    float height;
+    float light_x;
+    float light_y;
+    float light_r;
+    SDL_FRect *blocks;
+    float *block_ior;
+    float *block_vx;
+    float *block_vy;
+    int num_blocks;
+    int block_capacity;
+    struct GRFX_BVH bvh;
+    struct GRFX_SDF sdf;
+    struct GRFX_Segments segments;
+    struct GRFX_Circles circles;
+    struct GRFX_Polygons polygons;
+    struct GRFX_Mask mask;
+    void *cache;
+    size_t cache_size;
+};
+
+// Occluder counts of a scene, to roll it back to later
+struct GRFX_Scene_Mark {
+    int blocks;
+    int segments;
+    int circles;
+    int polygons;
+};
+
+// Closest hit along a ray, with the exact surface normal at the hit point
+struct GRFX_Hit {
+    int kind;
+    int id;
+    float t;
+    float x;
+    float y;
+    float nx;
+    float ny;
+};
+
+// A ray record in the ray tree
+struct GRFX_Ray {
+    float x;
+    float y;
+    float dx;
+    float dy;
+    float energy;
+    int depth;
+    int prev_kind;
+    int prev_id;
+    int inside;
+};
+
+// Arena of ray records, allocated once and reused by every trace. Once warmed it also remembers the block each
+// ray's first HIT_CACHE_SLOTS records hit, and the next trace walks the BVH bounded by those blocks first.
+struct GRFX_Ray_Pool {
+    struct GRFX_Ray *rays;
+    int count;
+    int capacity;
+    bool warm;
+    Sint32 *hints;
+    int hint_rays;
+};
+
+// A ray to trace: origin and unit direction
+struct GRFX_Ray_Query {
+    float x;
+    float y;
+    float dx;
+    float dy;
+};
+
+// Does the point (x, y) see the light at (light_x, light_y)
+struct GRFX_Visibility_Query {
+    float x;
+    float y;
+    float light_x;
+    float light_y;
+};
+
+// One straight piece of a traced ray, from (x1, y1) to whatever it hit at (x2, y2). cost is the tests and
+// steps spent finding that hit plus one for the segment itself, or just the one when built with GRFX_NO_STATS.
+struct GRFX_Ray_Segment {
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+    float energy;
+    int ray;
+    int hit_kind;
+    int hit_id;
+    Uint32 cost;
+};
+
+// Tracer work counters, all Uint64 so they can be summed as an array
+struct GRFX_Stats {
+    Uint64 frame_ns;
+    Uint64 rays;
+    Uint64 bounces;
+    Uint64 slab_tests;
+    Uint64 node_tests;
+    Uint64 segment_tests;
+    Uint64 circle_tests;
+    Uint64 block_hits;
+    Uint64 segment_hits;
+    Uint64 circle_hits;
+    Uint64 wall_hits;
+    Uint64 segments;
+    Uint64 draw_calls;
+    Uint64 bytes_uploaded;
+    Uint64 culled;
+    Uint64 allocations;
+    Uint64 bvh_refits;
+    Uint64 bvh_rebuilds;
+    Uint64 sdf_steps;
+    Uint64 mask_steps;
+    Uint64 gi_steps;
+    Uint64 power_level;
+    Uint64 power_changes;
+    Uint64 hits_per_block[STATS_MAX_BLOCKS];
+};
+
+// Bump allocator for memory that only lives for one frame
+struct GRFX_Arena {
+    Uint8 *base;
+    size_t size;
+    size_t used;
+    size_t peak;
+    void *overflow;
+};
+
+// Per-thread counter blocks and their per-frame aggregate
+struct GRFX_Stats_State {
+    struct GRFX_Stats *threads[STATS_MAX_THREADS];
+    int num_threads;
+    struct GRFX_Stats frame;
+    struct GRFX_Stats total;
+    struct GRFX_Stats *history;
+    Uint64 frames;
+    Uint32 last_allocations;
+};
+
+// What a worker thread needs to find its pool and its index
+struct GRFX_Worker_Arg {
+    struct GRFX_Workers *workers;
+    int index;
+};
+
+// A fixed pool of worker threads running parallel-for jobs. Thread 0 is the caller.
+struct GRFX_Workers {
+    SDL_Thread *threads[MAX_WORKERS];
+    struct GRFX_Worker_Arg args[MAX_WORKERS];
+    struct GRFX_Stats stats[MAX_WORKERS];
+    int num_threads;
+    SDL_Mutex *lock;
+    SDL_Condition *start;
+    SDL_Condition *done;
+    int generation;
+    int busy;
+    int quit;
+    SDL_AtomicInt next;
+    int count;
+    void (*fn)(void *data, int index, int thread);
+    void *data;
+};
+
+// A line to rasterize, in pixels
+struct GRFX_Raster_Line {
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+    SDL_Color color;
+};
+
+// Software rasterizer for ray segments. Lines are binned into RASTER_TILE square tiles
+// and every tile is drawn by one worker, into an RGBA32 framebuffer.
+struct GRFX_Raster {
+    int width;
+    int height;
+    int pitch;
+    Uint8 *pixels;
+    int tiles_x;
+    int tiles_y;
+    struct GRFX_Raster_Line *lines;
+    int num_lines;
+    int line_capacity;
+    int *bin_start;
+    int *bins;
+    int bin_capacity;
+};
+
+extern struct GRFX_Stats_State grfx_stats_state;
+
+// Counter block of the calling thread
+extern _Thread_local struct GRFX_Stats *grfx_stats;
+
+// Create an empty scene bounded by a width x height box
+struct GRFX_Scene GRFX_Create_Scene(float width, float height);
+
+// Free everything the scene holds
+void GRFX_Destroy_Scene(struct GRFX_Scene *scene);
+
+// Remove all occluders but keep the allocations for reuse, except the mask which is freed
+void GRFX_Clear_Scene(struct GRFX_Scene *scene);
+
+// Remember how many occluders the scene holds now
+struct GRFX_Scene_Mark GRFX_Mark_Scene(const struct GRFX_Scene *scene);
+
+// Drop every occluder added after the mark
+void GRFX_Reset_Scene(struct GRFX_Scene *scene, struct GRFX_Scene_Mark mark);
+
+// Add copies of all of other's occluders to the scene, except its mask
+void GRFX_Append_Scene(struct GRFX_Scene *scene, const struct GRFX_Scene *other);
+
+// Replace the scene's occluders with a scene file, returns false and sets the SDL error on failure.
+// The size is kept unless the file sets one, the light defaults to the middle.
+// One item per line, '#' starts a comment:
+//   size w h | light x y r | block x y w h [ior [vx vy]] | segment x1 y1 x2 y2 | circle x y r | polygon n x1 y1 ... xn yn
+//   | mask file.bmp x y cell (relative to the scene file)
+bool GRFX_Load_Scene(struct GRFX_Scene *scene, const char *path);
+
+// Give the scene an occupancy mask made from a surface, replacing any it had. Pixels that are opaque
+// and darker than mid grey are set, each one covers cell x cell units from (x, y). Rays walk the mask
+// cell by cell, so its cost goes with the cells crossed rather than how many pixels are set.
+bool GRFX_Set_Mask(struct GRFX_Scene *scene, SDL_Surface *surface, float x, float y, float cell);
+
+// Load the scene's mask from a BMP file
+bool GRFX_Load_Mask(struct GRFX_Scene *scene, const char *path, float x, float y, float cell);
+
+// Free the mask
+void GRFX_Destroy_Mask(struct GRFX_Mask *mask);
+
+// Add an axis aligned block, ior 0 makes it a mirror and anything above makes it glass. Returns its id
+int GRFX_Add_Block(struct GRFX_Scene *scene, float x, float y, float w, float h, float ior);
+
+// Give a block a velocity in units per second, used by GRFX_Animate_Blocks
+void GRFX_Set_Block_Velocity(struct GRFX_Scene *scene, int id, float vx, float vy);
+
+// Move every block by its velocity over dt seconds, bouncing off the scene's walls
+void GRFX_Animate_Blocks(struct GRFX_Scene *scene, float dt);
+
+// Bring the block BVH up to date after blocks moved or were added: refit it, or rebuild it
+// when the refit tree costs more than BVH_REBUILD_RATIO times a fresh one. Scenes with fewer
+// than BVH_MIN_BLOCKS blocks are traced without it.
+void GRFX_Update_BVH(struct GRFX_Scene *scene);
+
+// Build the block BVH from scratch
+void GRFX_Build_BVH(struct GRFX_Scene *scene);
+
+// Recompute node bounds bottom up without changing the tree, returns the new cost
+float GRFX_Refit_BVH(struct GRFX_Scene *scene);
+
+// Free the BVH
+void GRFX_Destroy_BVH(struct GRFX_BVH *bvh);
+
+// Bloom buffers for images of width x height
+struct GRFX_Bloom GRFX_Create_Bloom(int width, int height);
+
+// Add glow to an RGBA32 image in place: bright pass, blur along rows then columns and composite,
+// each split by rows over the worker threads
+void GRFX_Apply_Bloom(struct GRFX_Bloom *bloom, Uint8 *pixels, int pitch, struct GRFX_Workers *workers);
+
+// Free the bloom buffers
+void GRFX_Destroy_Bloom(struct GRFX_Bloom *bloom);
+
+// Cost grid over a width x height image, cell pixels per cell
+struct GRFX_Heatmap GRFX_Create_Heatmap(int width, int height, int cell);
+
+// Free the cost grid
+void GRFX_Destroy_Heatmap(struct GRFX_Heatmap *heatmap);
+
+// Zero every cell
+void GRFX_Heatmap_Begin(struct GRFX_Heatmap *heatmap);
+
+// Add cost to every cell the line from (x1, y1) to (x2, y2) crosses
+void GRFX_Heatmap_Add(struct GRFX_Heatmap *heatmap, float x1, float y1, float x2, float y2, float cost);
+
+// One color per cell, width x height of them: transparent where there was no cost, then blue, red and yellow on a log scale
+void GRFX_Heatmap_Colors(const struct GRFX_Heatmap *heatmap, SDL_Color *colors);
+
+// Trace a fan of num_rays evenly spaced rays to depth from every grid point over bounds, split by rows over the workers
+void GRFX_Bake_Light_Cache(struct GRFX_Light_Cache *cache, const struct GRFX_Scene *scene, SDL_FRect bounds, float cell, int num_rays, int depth, struct GRFX_Workers *workers);
+
+// True when the cache covers bounds with the same fan and depth, and the scene has not changed since it was baked
+bool GRFX_Light_Cache_Valid(const struct GRFX_Light_Cache *cache, const struct GRFX_Scene *scene, SDL_FRect bounds, int num_rays, int depth);
+
+// Segments for a light at (x, y) from the four grid points around it: interpolated for rays that hit the same
+// things from all four, from the nearest point otherwise. Returns how many were written, -1 when (x, y) is outside.
+int GRFX_Lookup_Light_Cache(const struct GRFX_Light_Cache *cache, float x, float y, struct GRFX_Ray_Segment *out, int max_out);
+
+// Free the baked paths
+void GRFX_Destroy_Light_Cache(struct GRFX_Light_Cache *cache);
+
+// Content hash of everything the BVH and a distance field with the given cell size are built from
+Uint64 GRFX_Hash_Scene(const struct GRFX_Scene *scene, float cell);
+
+// Map the BVH and a distance field with the given cell size (0 for none) from the cache file at path
+// when it was written for the same scene content. Otherwise build them and write the file.
+// Returns true when the cache file was used.
+bool GRFX_Open_Cache(struct GRFX_Scene *scene, const char *path, float cell, struct GRFX_Workers *workers);
+
+// Write the scene's BVH and distance field to path, replacing the file in one rename
+bool GRFX_Save_Cache(const struct GRFX_Scene *scene, const char *path);
+
+// Unmap the scene's cache file, once neither the BVH nor the distance field point into it
+void GRFX_Close_Cache(struct GRFX_Scene *scene);
+
+// Build a distance field over the whole scene, after which rays are sphere traced through it
+// instead of testing every occluder. Distances are clamped to SDF_MAX_DIST.
+void GRFX_Build_SDF(struct GRFX_Scene *scene, float cell, struct GRFX_Workers *workers);
+
+// Mark a region whose occluders changed, or the whole scene when region is NULL
+void GRFX_Invalidate_SDF(struct GRFX_Scene *scene, const SDL_FRect *region);
+
+// Recompute the invalidated part of the distance field
+void GRFX_Update_SDF(struct GRFX_Scene *scene, struct GRFX_Workers *workers);
+
+// Free the distance field, rays go back to testing occluders
+void GRFX_Destroy_SDF(struct GRFX_SDF *sdf);
+
+// Mark a region whose occluders changed, or everything when region is NULL
+void GRFX_Invalidate_GI(struct GRFX_GI *gi, const SDL_FRect *region);
+
+// Bring the illumination of domain up to date with the scene and its light, marching the scene's distance field
+// (needs GRFX_Build_SDF). Returns true when the fluence changed, false once it has settled.
+// The fluence of cascade 0 probe (px, py) is fluence[py * cascades[0].width + px].
+bool GRFX_Update_GI(struct GRFX_GI *gi, const struct GRFX_Scene *scene, SDL_FRect domain, struct GRFX_Workers *workers);
+
+// Free the cascades
+void GRFX_Destroy_GI(struct GRFX_GI *gi);
+
+// Add a line segment occluder, returns its id
+int GRFX_Add_Segment(struct GRFX_Scene *scene, float x1, float y1, float x2, float y2);
+
+// Add a convex polygon occluder from n points, returns its id
+int GRFX_Add_Polygon(struct GRFX_Scene *scene, const float *points, int n);
+
+// Add a circle occluder, returns its id, or -1 when r isn't positive
+int GRFX_Add_Circle(struct GRFX_Scene *scene, float x, float y, float r);
+
+// Create a ray pool holding up to capacity ray records
+struct GRFX_Ray_Pool GRFX_Create_Ray_Pool(int capacity);
+
+// Free the ray pool
+void GRFX_Destroy_Ray_Pool(struct GRFX_Ray_Pool *pool);
+
+// Turn on the pool's hit cache for traces of up to max_rays rays, allocated here so tracing never allocates
+bool GRFX_Warm_Ray_Pool(struct GRFX_Ray_Pool *pool, int max_rays);
+
+// Find the closest occluder hit along a ray, skipping the occluder (prev_kind, prev_id)
+void GRFX_Trace_Closest(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, int prev_kind, int prev_id, struct GRFX_Hit *hit);
+
+// Find where a ray travelling inside a block leaves it
+void GRFX_Trace_Exit(const SDL_FRect *box, float x1, float y1, float dx, float dy, int id, struct GRFX_Hit *hit);
+
+// Find where a ray leaves the scene's bounding box and its direction after bouncing off the wall
+void GRFX_Trace_Wall(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, float *x2, float *y2, float *new_dx, float *new_dy);
+
+// Append a ray record to the pool, returns NULL when the energy, depth or pool budget is spent
+struct GRFX_Ray *GRFX_Push_Ray(struct GRFX_Ray_Pool *pool, float x, float y, float dx, float dy, float energy, int depth, int prev_kind, int prev_id, int inside);
+
+// Trace n rays with up to depth segments along every path, splitting at glass blocks.
+// Segments go into out (at most max_out of them), returns how many were written.
+// A depth of 1 never touches the pool's records, and scenes of up to FIXED_MAX_BLOCKS blocks use unrolled slab tests.
+int GRFX_Trace_Rays(const struct GRFX_Scene *scene, struct GRFX_Ray_Pool *pool, const struct GRFX_Ray_Query *rays, int n, int depth, struct GRFX_Ray_Segment *out, int max_out);
+
+// Closest hit for each of n rays, no bounces
+void GRFX_Trace_Hits(const struct GRFX_Scene *scene, const struct GRFX_Ray_Query *rays, int n, struct GRFX_Hit *hits);
+
+// Answer n visibility queries with shadow rays that stop at the first occluder, four at a time. Bit i % 64 of
+// visible[i / 64] is set when nothing lies strictly between query i's point and its light; blocks, glass ones
+// too, segments, circles and the mask all occlude. visible needs room for (n + 63) / 64 words.
+void GRFX_Trace_Visibility(const struct GRFX_Scene *scene, const struct GRFX_Visibility_Query *queries, int n, Uint64 *visible);
+
+// How much of a light of radius r at (x2, y2) is visible from (x1, y1), from 0 to 1, estimated from the
+// closest the distance field comes to the line between them. Needs GRFX_Build_SDF.
+float GRFX_Trace_Soft_Shadow(const struct GRFX_Scene *scene, float x1, float y1, float x2, float y2, float r);
+
+// Create a ring of num_slots slots in shared memory under name, each holding up to max_segments segments and a
+// max_width x max_height RGBA image. Returns false and sets SDL's error when the memory cannot be made.
+bool GRFX_Ring_Create(struct GRFX_Ring *ring, const char *name, int num_slots, int max_segments, int max_width, int max_height);
+
+// Map a ring another process created, returns false and sets SDL's error when there is none
+bool GRFX_Ring_Open(struct GRFX_Ring *ring, const char *name);
+
+// Unmap the ring, the writer also removes its name
+void GRFX_Ring_Close(struct GRFX_Ring *ring);
+
+// Writer: take the slot of the next frame and mark it as being written
+struct GRFX_Ring_Slot *GRFX_Ring_Begin(struct GRFX_Ring *ring);
+
+// Writer: publish the slot taken by GRFX_Ring_Begin
+void GRFX_Ring_End(struct GRFX_Ring *ring, struct GRFX_Ring_Slot *slot);
+
+// Frames published so far
+Uint32 GRFX_Ring_Frames(const struct GRFX_Ring *ring);
+
+// Reader: the slot holding frame, or NULL when it isn't published yet or was already overwritten.
+// Read it in place, then call GRFX_Ring_Read_End.
+const struct GRFX_Ring_Slot *GRFX_Ring_Read_Begin(const struct GRFX_Ring *ring, Uint32 frame);
+
+// Reader: true when the slot still held frame after it was read, false when the writer reused it meanwhile
+bool GRFX_Ring_Read_End(const struct GRFX_Ring_Slot *slot, Uint32 frame);
+
+// The segments of a slot
+struct GRFX_Ray_Segment *GRFX_Ring_Segments(const struct GRFX_Ring_Slot *slot);
+
+// The image of a slot
+Uint8 *GRFX_Ring_Pixels(const struct GRFX_Ring *ring, const struct GRFX_Ring_Slot *slot);
+
+// Create a pool with num_threads threads in total (counting the caller), or one per core when num_threads < 1
+struct GRFX_Workers *GRFX_Create_Workers(int num_threads);
+
+// Stop and free the worker threads
+void GRFX_Destroy_Workers(struct GRFX_Workers *workers);
+
+// Run fn(data, index, thread) for every index in [0, count) across the pool, returns once all are done
+void GRFX_Parallel_For(struct GRFX_Workers *workers, int count, void (*fn)(void *data, int index, int thread), void *data);
+
+// Take items of the current job until there are none left
+void GRFX_Worker_Run(struct GRFX_Workers *workers, int thread);
+
+// Create a width x height framebuffer and its tile bins
+struct GRFX_Raster GRFX_Create_Raster(int width, int height);
+
+// Free the framebuffer, lines and bins
+void GRFX_Destroy_Raster(struct GRFX_Raster *raster);
+
+// Forget the lines of the last frame
+void GRFX_Raster_Begin(struct GRFX_Raster *raster);
+
+// Queue a line, drawn in the order it was added and alpha blended like SDL_BLENDMODE_BLEND
+void GRFX_Raster_Add_Line(struct GRFX_Raster *raster, float x1, float y1, float x2, float y2, SDL_Color color);
+
+// Clear the framebuffer to opaque black and draw every queued line, one tile per job on the workers
+void GRFX_Raster_Draw(struct GRFX_Raster *raster, struct GRFX_Workers *workers);
+
+// Count SDL's allocations too, call before SDL allocates anything
+void GRFX_Alloc_Init();
+
+// Heap allocations made so far by any thread, wraps around
+Uint32 GRFX_Alloc_Count();
+
+// Create an arena holding size bytes
+struct GRFX_Arena GRFX_Create_Arena(size_t size);
+
+// Free the arena
+void GRFX_Destroy_Arena(struct GRFX_Arena *arena);
+
+// 16 byte aligned memory valid until the next reset. When the arena is full the memory comes from the heap instead.
+void *GRFX_Arena_Alloc(struct GRFX_Arena *arena, size_t size);
+
+// Release everything at once. An arena that overflowed grows to fit the largest frame, so only frames after growth touch the heap.
+void GRFX_Arena_Reset(struct GRFX_Arena *arena);
+
+// Set up the stats state and register the calling thread's counters
+void GRFX_Stats_Init();
+
+// Give the calling thread its own counter block, summed at the end of every frame
+void GRFX_Stats_Register_Thread(struct GRFX_Stats *stats);
+
+// Sum a counter block at the end of every frame, the thread owning it points grfx_stats at it
+void GRFX_Stats_Track(struct GRFX_Stats *stats);
+
+// Stop summing a counter block
+void GRFX_Stats_Untrack(struct GRFX_Stats *stats);
+
+// Aggregate and reset the per-thread counters into the frame and total stats
+void GRFX_Stats_Frame_End(Uint64 frame_ns);
+
+// Write totals as JSON (.json) or the recorded frames as CSV (anything else)
+void GRFX_Stats_Dump(const char *path);
+
+// Free the stats history
+void GRFX_Stats_End();
+
+// Distance between (x1,y1) and (x2,y2)
+int MAF_Distance(int x1, int y1, int x2, int y2 );
+
+// Closest ray-segment hit over all segments, returns the segment index or -1
+int MAF_Ray_Segments(const struct GRFX_Segments *segs, float ox, float oy, float dx, float dy, int skip, float *t_hit);
+
+// Closest ray-circle hit over all circles, returns the circle index or -1
+int MAF_Ray_Circles(const struct GRFX_Circles *circles, float ox, float oy, float dx, float dy, int skip, float *t_hit);
+
+// Clip the segment (x1,y1)-(x2,y2) to a box in place (Liang-Barsky), returns false when nothing is left
+bool MAF_Clip_Segment(const SDL_FRect *box, float *x1, float *y1, float *x2, float *y2);
+
+// The i'th point of a low discrepancy (R2) sequence mapped onto a disk of radius r
+void MAF_Disk_Sample(int i, float r, float *x, float *y);
+
+#pragma endregion Declare
+
+#endif
@@ -0,0 +1,135 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Alloc Def
+
+static SDL_AtomicInt grfx_allocations;
+static SDL_malloc_func grfx_sdl_malloc;
+static SDL_calloc_func grfx_sdl_calloc;
+static SDL_realloc_func grfx_sdl_realloc;
+
+// On glibc malloc itself is replaced, which also catches allocations made by libc and other libraries
+#ifdef GRFX_MALLOC_HOOK
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *mem, size_t size);
+extern void __libc_free(void *mem);
+
+void *malloc(size_t size) {
+    SDL_AddAtomicInt(&grfx_allocations, 1);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size) {
+    SDL_AddAtomicInt(&grfx_allocations, 1);
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *mem, size_t size) {
+    SDL_AddAtomicInt(&grfx_allocations, 1);
+    return __libc_realloc(mem, size);
+}
+
+void free(void *mem) {
+    __libc_free(mem);
+}
+
+#endif
+
+// SDL's allocations, counted here unless they already went through the malloc hook
+static void *SDLCALL GRFX_SDL_Malloc(size_t size) {
+#ifndef GRFX_MALLOC_HOOK
+    SDL_AddAtomicInt(&grfx_allocations, 1);
+#endif
+    return grfx_sdl_malloc(size);
+}
+
+static void *SDLCALL GRFX_SDL_Calloc(size_t num, size_t size) {
+#ifndef GRFX_MALLOC_HOOK
+    SDL_AddAtomicInt(&grfx_allocations, 1);
+#endif
+    return grfx_sdl_calloc(num, size);
+}
+
+static void *SDLCALL GRFX_SDL_Realloc(void *mem, size_t size) {
+#ifndef GRFX_MALLOC_HOOK
+    SDL_AddAtomicInt(&grfx_allocations, 1);
+#endif
+    return grfx_sdl_realloc(mem, size);
+}
+
+void GRFX_Alloc_Init() {
+    SDL_free_func sdl_free;
+
+    SDL_GetOriginalMemoryFunctions(&grfx_sdl_malloc, &grfx_sdl_calloc, &grfx_sdl_realloc, &sdl_free);
+    SDL_SetMemoryFunctions(GRFX_SDL_Malloc, GRFX_SDL_Calloc, GRFX_SDL_Realloc, sdl_free);
+}
+
+Uint32 GRFX_Alloc_Count() {
+    return SDL_GetAtomicInt(&grfx_allocations);
+}
+
+#pragma endregion Alloc Def
+
+#pragma region Arena Def
+
+// Overflow blocks are chained in front of their memory, aligned like the arena
+#define ARENA_ALIGN 16
+#define ARENA_HEADER ARENA_ALIGN
+
+struct GRFX_Arena GRFX_Create_Arena(size_t size) {
+    struct GRFX_Arena arena;
+
+    memset(&arena, 0, sizeof(arena));
+    arena.base = SDL_aligned_alloc(ARENA_ALIGN, size);
+    arena.size = arena.base != NULL ? size : 0;
+
+    return arena;
+}
+
+void GRFX_Destroy_Arena(struct GRFX_Arena *arena) {
+    GRFX_Arena_Reset(arena);
+    SDL_aligned_free(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void *GRFX_Arena_Alloc(struct GRFX_Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    arena->used += size;
+
+    if (arena->used > arena->peak) arena->peak = arena->used;
+
+    if (arena->used <= arena->size) return arena->base + arena->used - size;
+
+    // Out of room: this frame gets a heap block, the next reset grows the arena to fit
+    Uint8 *block = SDL_aligned_alloc(ARENA_ALIGN, ARENA_HEADER + size);
+    if (block == NULL) return NULL;
+
+    *(void **)block = arena->overflow;
+    arena->overflow = block;
+
+    return block + ARENA_HEADER;
+}
+
+void GRFX_Arena_Reset(struct GRFX_Arena *arena) {
+    if (arena->overflow != NULL) {
+        while (arena->overflow != NULL) {
+            void *next = *(void **)arena->overflow;
+            SDL_aligned_free(arena->overflow);
+            arena->overflow = next;
+        }
+
+        // Grow to the largest frame seen so steady frames fit without touching the heap
+        SDL_aligned_free(arena->base);
+        arena->base = SDL_aligned_alloc(ARENA_ALIGN, arena->peak);
+        arena->size = arena->base != NULL ? arena->peak : 0;
+    }
+
+    arena->used = 0;
+}
+
+#pragma endregion Arena Def
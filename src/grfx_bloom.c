@@ -0,0 +1,314 @@
+#pragma region Include
+
+#include "grfx.h"
+#include <SDL3/SDL_intrin.h>
+
+#pragma endregion Include
+
+#pragma region Bloom Def
+
+struct GRFX_Bloom GRFX_Create_Bloom(int width, int height) {
+    struct GRFX_Bloom bloom;
+    float sigma = BLOOM_RADIUS / 2.5f, sum = 0;
+
+    memset(&bloom, 0, sizeof(bloom));
+    bloom.width = width;
+    bloom.height = height;
+    bloom.low_width = (width + BLOOM_SCALE - 1) / BLOOM_SCALE;
+    bloom.low_height = (height + BLOOM_SCALE - 1) / BLOOM_SCALE;
+    bloom.threshold = BLOOM_THRESHOLD;
+    bloom.intensity = BLOOM_INTENSITY;
+    bloom.bright = malloc((size_t)bloom.low_width * bloom.low_height * 4 * sizeof(float));
+    bloom.blur = malloc((size_t)bloom.low_width * bloom.low_height * 4 * sizeof(float));
+
+    // Normalized over both sides, so a flat image keeps its brightness
+    for (int k = 0; k <= BLOOM_RADIUS; k++) {
+        bloom.weights[k] = expf(-(k * k) / (2 * sigma * sigma));
+        sum += k == 0 ? bloom.weights[k] : 2 * bloom.weights[k];
+    }
+
+    for (int k = 0; k <= BLOOM_RADIUS; k++) bloom.weights[k] /= sum;
+
+    // Between two low-res centers every run of BLOOM_SCALE pixels lerps with the same fractions, in 1/128ths
+    for (int k = 0; k < BLOOM_SCALE; k++) {
+        bloom.lerp[k] = (Sint16)lroundf(((BLOOM_SCALE / 2 + k + 0.5f) / BLOOM_SCALE - 0.5f) * 128);
+    }
+
+    return bloom;
+}
+
+void GRFX_Destroy_Bloom(struct GRFX_Bloom *bloom) {
+    free(bloom->bright);
+    free(bloom->blur);
+    free(bloom->scratch);
+    memset(bloom, 0, sizeof(*bloom));
+}
+
+// Worker job: average a BLOOM_SCALE square of the image into one low-res pixel and keep what is above the threshold
+static void GRFX_Bloom_Bright(void *data, int ly, int thread) {
+    (void)thread;
+    struct GRFX_Bloom *bloom = data;
+    int y_min = ly * BLOOM_SCALE, y_max = SDL_min(y_min + BLOOM_SCALE, bloom->height);
+    float *out = bloom->bright + (size_t)ly * bloom->low_width * 4;
+    int lx = 0;
+
+#ifdef SDL_SSE2_INTRINSICS
+    // Four whole squares side by side: summed like below, then turned into channel vectors and thresholded together
+    if (y_max - y_min == 4) {
+        __m128i zero = _mm_setzero_si128();
+        __m128 scale = _mm_set1_ps(1.0f / (255.0f * 16)), threshold = _mm_set1_ps(bloom->threshold);
+
+        for (; (lx + 4) * 4 <= bloom->width; lx += 4) {
+            __m128 color[4];
+
+            for (int s = 0; s < 4; s++) {
+                __m128i lo = zero, hi = zero;
+
+                for (int y = y_min; y < y_max; y++) {
+                    __m128i v = _mm_loadu_si128((const __m128i *)(bloom->pixels + y * bloom->pitch + (lx + s) * 16));
+                    lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+                    hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+                }
+
+                __m128i sum = _mm_add_epi16(lo, hi);
+                sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+                color[s] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(sum, zero)), scale);
+            }
+
+            // Now red, green, blue and alpha of the four squares
+            _MM_TRANSPOSE4_PS(color[0], color[1], color[2], color[3]);
+
+            __m128 luma = _mm_add_ps(_mm_add_ps(_mm_mul_ps(color[0], _mm_set1_ps(0.2126f)), _mm_mul_ps(color[1], _mm_set1_ps(0.7152f))),
+                _mm_mul_ps(color[2], _mm_set1_ps(0.0722f)));
+            __m128 keep = _mm_and_ps(_mm_cmpgt_ps(luma, threshold), _mm_div_ps(_mm_sub_ps(luma, threshold), luma));
+
+            color[0] = _mm_mul_ps(color[0], keep);
+            color[1] = _mm_mul_ps(color[1], keep);
+            color[2] = _mm_mul_ps(color[2], keep);
+            color[3] = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(color[0], color[1], color[2], color[3]);
+
+            for (int s = 0; s < 4; s++) _mm_storeu_ps(out + (lx + s) * 4, color[s]);
+        }
+    }
+#endif
+
+    for (; lx < bloom->low_width; lx++) {
+        int x_min = lx * BLOOM_SCALE, x_max = SDL_min(x_min + BLOOM_SCALE, bloom->width);
+        int r = 0, g = 0, b = 0;
+
+#ifdef SDL_SSE2_INTRINSICS
+        // A whole square is four rows of four pixels, summed as 16 bit lanes
+        if (x_max - x_min == 4 && y_max - y_min == 4) {
+            __m128i zero = _mm_setzero_si128(), lo = zero, hi = zero;
+
+            for (int y = y_min; y < y_max; y++) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(bloom->pixels + y * bloom->pitch + x_min * 4));
+                lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+                hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+            }
+
+            __m128i sum = _mm_add_epi16(lo, hi);
+            sum = _mm_unpacklo_epi16(_mm_add_epi16(sum, _mm_srli_si128(sum, 8)), zero);
+            r = _mm_cvtsi128_si32(sum);
+            g = _mm_cvtsi128_si32(_mm_srli_si128(sum, 4));
+            b = _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+        } else
+#endif
+        for (int y = y_min; y < y_max; y++) {
+            const Uint8 *p = bloom->pixels + y * bloom->pitch + x_min * 4;
+            for (int x = x_min; x < x_max; x++, p += 4) {
+                r += p[0], g += p[1], b += p[2];
+            }
+        }
+
+        float scale = 1.0f / (255.0f * (x_max - x_min) * (y_max - y_min));
+        float fr = r * scale, fg = g * scale, fb = b * scale;
+        float luma = 0.2126f * fr + 0.7152f * fg + 0.0722f * fb;
+
+        // Soft threshold on brightness, so colors keep their hue
+        float keep = luma > bloom->threshold ? (luma - bloom->threshold) / luma : 0;
+
+        out[lx * 4] = fr * keep;
+        out[lx * 4 + 1] = fg * keep;
+        out[lx * 4 + 2] = fb * keep;
+        out[lx * 4 + 3] = 0;
+    }
+}
+
+// Worker job: blur one low-res row along x, clamping at the edges
+static void GRFX_Bloom_Row(void *data, int ly, int thread) {
+    (void)thread;
+    struct GRFX_Bloom *bloom = data;
+    int w = bloom->low_width;
+    const float *in = bloom->bright + (size_t)ly * w * 4;
+    float *out = bloom->blur + (size_t)ly * w * 4;
+
+    for (int x = 0; x < w; x++) {
+#ifdef SDL_SSE_INTRINSICS
+        // Away from the edges no tap needs clamping, and two pixels at a time keep two sums in flight
+        if (x >= BLOOM_RADIUS && x + 1 + BLOOM_RADIUS < w) {
+            const float *c = in + x * 4;
+            __m128 weight = _mm_set1_ps(bloom->weights[0]);
+            __m128 sum0 = _mm_mul_ps(_mm_loadu_ps(c), weight), sum1 = _mm_mul_ps(_mm_loadu_ps(c + 4), weight);
+
+            for (int k = 1; k <= BLOOM_RADIUS; k++) {
+                weight = _mm_set1_ps(bloom->weights[k]);
+                sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(c - k * 4), _mm_loadu_ps(c + k * 4)), weight));
+                sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(c + 4 - k * 4), _mm_loadu_ps(c + 4 + k * 4)), weight));
+            }
+
+            _mm_storeu_ps(out + x * 4, sum0);
+            _mm_storeu_ps(out + x * 4 + 4, sum1);
+            x++;
+            continue;
+        }
+
+        __m128 sum = _mm_mul_ps(_mm_loadu_ps(in + x * 4), _mm_set1_ps(bloom->weights[0]));
+
+        for (int k = 1; k <= BLOOM_RADIUS; k++) {
+            __m128 pair = _mm_add_ps(_mm_loadu_ps(in + SDL_max(x - k, 0) * 4), _mm_loadu_ps(in + SDL_min(x + k, w - 1) * 4));
+            sum = _mm_add_ps(sum, _mm_mul_ps(pair, _mm_set1_ps(bloom->weights[k])));
+        }
+
+        _mm_storeu_ps(out + x * 4, sum);
+#else
+        for (int c = 0; c < 4; c++) {
+            float sum = in[x * 4 + c] * bloom->weights[0];
+
+            for (int k = 1; k <= BLOOM_RADIUS; k++) {
+                sum += (in[SDL_max(x - k, 0) * 4 + c] + in[SDL_min(x + k, w - 1) * 4 + c]) * bloom->weights[k];
+            }
+
+            out[x * 4 + c] = sum;
+        }
+#endif
+    }
+}
+
+// Worker job: blur one low-res row along y. Every tap is a whole row, read sequentially, and each sum stays
+// in a register until all taps are in.
+static void GRFX_Bloom_Column(void *data, int ly, int thread) {
+    (void)thread;
+    struct GRFX_Bloom *bloom = data;
+    int h = bloom->low_height, n = bloom->low_width * 4, i = 0;
+    const float *rows[2 * BLOOM_RADIUS + 1];
+    float *out = bloom->bright + (size_t)ly * n;
+
+    for (int k = -BLOOM_RADIUS; k <= BLOOM_RADIUS; k++) rows[BLOOM_RADIUS + k] = bloom->blur + (size_t)SDL_clamp(ly + k, 0, h - 1) * n;
+
+    const float *center = rows[BLOOM_RADIUS];
+
+#ifdef SDL_SSE_INTRINSICS
+    for (; i + 8 <= n; i += 8) {
+        __m128 weight = _mm_set1_ps(bloom->weights[0]);
+        __m128 sum0 = _mm_mul_ps(_mm_loadu_ps(center + i), weight), sum1 = _mm_mul_ps(_mm_loadu_ps(center + i + 4), weight);
+
+        for (int k = 1; k <= BLOOM_RADIUS; k++) {
+            const float *above = rows[BLOOM_RADIUS - k] + i, *below = rows[BLOOM_RADIUS + k] + i;
+            weight = _mm_set1_ps(bloom->weights[k]);
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(above), _mm_loadu_ps(below)), weight));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(above + 4), _mm_loadu_ps(below + 4)), weight));
+        }
+
+        _mm_storeu_ps(out + i, sum0);
+        _mm_storeu_ps(out + i + 4, sum1);
+    }
+#endif
+
+    for (; i < n; i++) {
+        float sum = center[i] * bloom->weights[0];
+        for (int k = 1; k <= BLOOM_RADIUS; k++) sum += (rows[BLOOM_RADIUS - k][i] + rows[BLOOM_RADIUS + k][i]) * bloom->weights[k];
+        out[i] = sum;
+    }
+}
+
+// Add the glow at a plus f/128ths of the way to the next column a + 4 to one pixel
+static inline void GRFX_Bloom_Pixel(Uint8 *p, const Sint16 *a, int f) {
+    for (int c = 0; c < 3; c++) p[c] = (Uint8)SDL_min(p[c] + a[c] + (((a[c + 4] - a[c]) * f) >> 7), 255);
+}
+
+// Worker job: add the blurred glow to one row of the image, upsampled bilinearly
+static void GRFX_Bloom_Composite(void *data, int y, int thread) {
+    struct GRFX_Bloom *bloom = data;
+    int w = bloom->low_width, h = bloom->low_height, half = BLOOM_SCALE / 2, i = 0, x = 0;
+    Sint16 *line = bloom->scratch + (size_t)thread * (w + 1) * 4;
+    float gain = bloom->intensity * 255;
+    Uint8 *p = bloom->pixels + y * bloom->pitch;
+
+    // Blend the two low-res rows around this one into 8 bit glow first, then each pixel only needs an integer lerp along x
+    float v = (y + 0.5f) / BLOOM_SCALE - 0.5f;
+    int y0 = SDL_clamp((int)floorf(v), 0, h - 1), y1 = SDL_min(y0 + 1, h - 1);
+    float fy = SDL_clamp(v - y0, 0.0f, 1.0f);
+    const float *row0 = bloom->bright + (size_t)y0 * w * 4, *row1 = bloom->bright + (size_t)y1 * w * 4;
+
+#ifdef SDL_SSE2_INTRINSICS
+    __m128 v_fy = _mm_set1_ps(fy), v_gain = _mm_set1_ps(gain), v_max = _mm_set1_ps(255);
+
+    for (; i + 8 <= w * 4; i += 8) {
+        __m128 a = _mm_loadu_ps(row0 + i), b = _mm_loadu_ps(row0 + i + 4);
+        __m128 lo = _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row1 + i), a), v_fy)), v_gain);
+        __m128 hi = _mm_mul_ps(_mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row1 + i + 4), b), v_fy)), v_gain);
+        __m128i glow = _mm_packs_epi32(_mm_cvtps_epi32(_mm_min_ps(lo, v_max)), _mm_cvtps_epi32(_mm_min_ps(hi, v_max)));
+        _mm_storeu_si128((__m128i *)(line + i), _mm_max_epi16(glow, _mm_setzero_si128()));
+    }
+#endif
+
+    for (; i < w * 4; i++) line[i] = (Sint16)SDL_clamp((int)((row0[i] + (row1[i] - row0[i]) * fy) * gain + 0.5f), 0, 255);
+
+    // The last column again, so the right edge can lerp to the next one too
+    memcpy(line + w * 4, line + (w - 1) * 4, 4 * sizeof(Sint16));
+
+    // Left of the first low-res center the glow is that column's
+    for (; x < half && x < bloom->width; x++) GRFX_Bloom_Pixel(p + x * 4, line, 0);
+
+#if defined(SDL_SSE2_INTRINSICS) && BLOOM_SCALE == 4
+    __m128i lerp_01 = _mm_set_epi16(bloom->lerp[1], bloom->lerp[1], bloom->lerp[1], bloom->lerp[1], bloom->lerp[0], bloom->lerp[0], bloom->lerp[0], bloom->lerp[0]);
+    __m128i lerp_23 = _mm_set_epi16(bloom->lerp[3], bloom->lerp[3], bloom->lerp[3], bloom->lerp[3], bloom->lerp[2], bloom->lerp[2], bloom->lerp[2], bloom->lerp[2]);
+#endif
+
+    for (int c = 0; c + 1 < w && x < bloom->width; c++) {
+        const Sint16 *a = line + c * 4;
+
+#if defined(SDL_SSE2_INTRINSICS) && BLOOM_SCALE == 4
+        // The four pixels between two centers at once: both columns come in one load, the glow's alpha is 0
+        if (x + 4 <= bloom->width) {
+            __m128i ab = _mm_loadu_si128((const __m128i *)a);
+            __m128i from = _mm_unpacklo_epi64(ab, ab), step = _mm_sub_epi16(_mm_unpackhi_epi64(ab, ab), from);
+            __m128i glow_01 = _mm_add_epi16(from, _mm_srai_epi16(_mm_mullo_epi16(step, lerp_01), 7));
+            __m128i glow_23 = _mm_add_epi16(from, _mm_srai_epi16(_mm_mullo_epi16(step, lerp_23), 7));
+            __m128i *pixel = (__m128i *)(p + x * 4);
+
+            _mm_storeu_si128(pixel, _mm_adds_epu8(_mm_loadu_si128(pixel), _mm_packus_epi16(glow_01, glow_23)));
+            x += 4;
+            continue;
+        }
+#endif
+
+        for (int k = 0; k < BLOOM_SCALE && x < bloom->width; k++, x++) GRFX_Bloom_Pixel(p + x * 4, a, bloom->lerp[k]);
+    }
+
+    // Right of the last center it is the last column's
+    for (; x < bloom->width; x++) GRFX_Bloom_Pixel(p + x * 4, line + (w - 1) * 4, 0);
+}
+
+void GRFX_Apply_Bloom(struct GRFX_Bloom *bloom, Uint8 *pixels, int pitch, struct GRFX_Workers *workers) {
+    int threads = workers != NULL ? workers->num_threads : 1;
+
+    if (bloom->bright == NULL) return;
+
+    if (threads > bloom->scratch_threads) {
+        bloom->scratch_threads = threads;
+        bloom->scratch = realloc(bloom->scratch, (size_t)threads * (bloom->low_width + 1) * 4 * sizeof(Sint16));
+    }
+
+    bloom->pixels = pixels;
+    bloom->pitch = pitch;
+
+    GRFX_Parallel_For(workers, bloom->low_height, GRFX_Bloom_Bright, bloom);
+    GRFX_Parallel_For(workers, bloom->low_height, GRFX_Bloom_Row, bloom);
+    GRFX_Parallel_For(workers, bloom->low_height, GRFX_Bloom_Column, bloom);
+    GRFX_Parallel_For(workers, bloom->height, GRFX_Bloom_Composite, bloom);
+}
+
+#pragma endregion Bloom Def
@@ -0,0 +1,179 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region BVH Def
+
+// Half perimeter stands in for surface area in 2D
+static float GRFX_BVH_Area(const struct GRFX_BVH_Node *node) {
+    return (node->x_max - node->x_min) + (node->y_max - node->y_min);
+}
+
+// Surface area heuristic cost of the whole tree, relative to its root
+static float GRFX_BVH_Cost(const struct GRFX_BVH *bvh) {
+    float root = GRFX_BVH_Area(&bvh->nodes[0]);
+    float cost = 0;
+
+    if (root <= 0) return 0;
+
+    for (int i = 0; i < bvh->num_nodes; i++) {
+        const struct GRFX_BVH_Node *node = &bvh->nodes[i];
+        cost += GRFX_BVH_Area(node) * (node->count > 0 ? node->count : 1);
+    }
+
+    return cost / root;
+}
+
+static void GRFX_BVH_Bounds(const struct GRFX_Scene *scene, struct GRFX_BVH_Node *node) {
+    const int *indices = scene->bvh.indices;
+
+    node->x_min = INFINITY, node->y_min = INFINITY;
+    node->x_max = -INFINITY, node->y_max = -INFINITY;
+
+    for (int i = node->first; i < node->first + node->count; i++) {
+        const SDL_FRect *box = &scene->blocks[indices[i]];
+        node->x_min = fminf(node->x_min, box->x);
+        node->y_min = fminf(node->y_min, box->y);
+        node->x_max = fmaxf(node->x_max, box->x + box->w);
+        node->y_max = fmaxf(node->y_max, box->y + box->h);
+    }
+}
+
+void GRFX_Build_BVH(struct GRFX_Scene *scene) {
+    struct GRFX_BVH *bvh = &scene->bvh;
+    int n = scene->num_blocks;
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+
+    // Mapped arrays are read-only as far as the heap goes, a fresh build starts new ones
+    if (bvh->mapped) {
+        bvh->nodes = NULL;
+        bvh->indices = NULL;
+        bvh->capacity = 0;
+        bvh->mapped = false;
+    }
+
+    // A binary tree with n leaves at most has 2n - 1 nodes
+    if (2 * n > bvh->capacity) {
+        bvh->capacity = 2 * n;
+        bvh->nodes = realloc(bvh->nodes, bvh->capacity * sizeof(struct GRFX_BVH_Node));
+        bvh->indices = realloc(bvh->indices, bvh->capacity * sizeof(int));
+    }
+
+    for (int i = 0; i < n; i++) bvh->indices[i] = i;
+
+    bvh->num_blocks = n;
+    bvh->num_nodes = 1;
+    bvh->nodes[0].first = 0;
+    bvh->nodes[0].count = n;
+    stack[top++] = 0;
+
+    // Children always land behind their parent, so refitting can walk the nodes backwards
+    while (top > 0) {
+        struct GRFX_BVH_Node *node = &bvh->nodes[stack[--top]];
+        int first = node->first, count = node->count;
+
+        GRFX_BVH_Bounds(scene, node);
+        if (count <= BVH_LEAF_SIZE || top + 2 > BVH_STACK_SIZE) continue;
+
+        // Split at the middle of the centroids along the longer axis
+        float c_min = INFINITY, c_max = -INFINITY;
+        int axis = node->x_max - node->x_min >= node->y_max - node->y_min ? 0 : 1;
+
+        for (int i = first; i < first + count; i++) {
+            const SDL_FRect *box = &scene->blocks[bvh->indices[i]];
+            float c = axis == 0 ? box->x + box->w / 2 : box->y + box->h / 2;
+            c_min = fminf(c_min, c);
+            c_max = fmaxf(c_max, c);
+        }
+
+        float split = (c_min + c_max) / 2;
+        int mid = first;
+
+        for (int i = first; i < first + count; i++) {
+            const SDL_FRect *box = &scene->blocks[bvh->indices[i]];
+            float c = axis == 0 ? box->x + box->w / 2 : box->y + box->h / 2;
+
+            if (c < split) {
+                int temp = bvh->indices[i];
+                bvh->indices[i] = bvh->indices[mid];
+                bvh->indices[mid++] = temp;
+            }
+        }
+
+        // Stacked or identical centroids, split the range in half instead
+        if (mid == first || mid == first + count) mid = first + count / 2;
+
+        int left = bvh->num_nodes;
+        bvh->num_nodes += 2;
+
+        bvh->nodes[left].first = first;
+        bvh->nodes[left].count = mid - first;
+        bvh->nodes[left + 1].first = mid;
+        bvh->nodes[left + 1].count = first + count - mid;
+
+        node->first = left;
+        node->count = 0;
+
+        stack[top++] = left;
+        stack[top++] = left + 1;
+    }
+
+    bvh->cost = GRFX_BVH_Cost(bvh);
+    bvh->build_cost = bvh->cost;
+    GRFX_STAT_ADD(bvh_rebuilds, 1);
+}
+
+float GRFX_Refit_BVH(struct GRFX_Scene *scene) {
+    struct GRFX_BVH *bvh = &scene->bvh;
+
+    for (int i = bvh->num_nodes - 1; i >= 0; i--) {
+        struct GRFX_BVH_Node *node = &bvh->nodes[i];
+
+        if (node->count > 0) {
+            GRFX_BVH_Bounds(scene, node);
+            continue;
+        }
+
+        const struct GRFX_BVH_Node *a = &bvh->nodes[node->first];
+        const struct GRFX_BVH_Node *b = &bvh->nodes[node->first + 1];
+        node->x_min = fminf(a->x_min, b->x_min);
+        node->y_min = fminf(a->y_min, b->y_min);
+        node->x_max = fmaxf(a->x_max, b->x_max);
+        node->y_max = fmaxf(a->y_max, b->y_max);
+    }
+
+    bvh->cost = GRFX_BVH_Cost(bvh);
+    GRFX_STAT_ADD(bvh_refits, 1);
+
+    return bvh->cost;
+}
+
+void GRFX_Update_BVH(struct GRFX_Scene *scene) {
+    struct GRFX_BVH *bvh = &scene->bvh;
+
+    if (scene->num_blocks < BVH_MIN_BLOCKS) return;
+
+    // Blocks were added or removed, the tree no longer covers them
+    if (bvh->num_blocks != scene->num_blocks) {
+        GRFX_Build_BVH(scene);
+        return;
+    }
+
+    // Refitting is cheap but boxes that moved apart make the tree loose, rebuild once it costs too much
+    if (GRFX_Refit_BVH(scene) > bvh->build_cost * BVH_REBUILD_RATIO) {
+        GRFX_Build_BVH(scene);
+    }
+}
+
+void GRFX_Destroy_BVH(struct GRFX_BVH *bvh) {
+    if (!bvh->mapped) {
+        free(bvh->nodes);
+        free(bvh->indices);
+    }
+    memset(bvh, 0, sizeof(*bvh));
+}
+
+#pragma endregion BVH Def
@@ -0,0 +1,317 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#ifdef SDL_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#pragma endregion Include
+
+#pragma region Cache Def
+
+#define CACHE_BYTE_ORDER 0x01020304u
+
+// FNV-1a over 8 byte words, each step is a bijection so changing any one word changes the hash
+static Uint64 GRFX_Hash(Uint64 hash, const void *data, size_t size) {
+    const Uint8 *bytes = data;
+    Uint64 word;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+
+    for (; i < size; i++) hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+    return hash;
+}
+
+Uint64 GRFX_Hash_Scene(const struct GRFX_Scene *scene, float cell) {
+    const struct GRFX_Segments *segs = &scene->segments;
+    const struct GRFX_Circles *circles = &scene->circles;
+    const struct GRFX_Mask *mask = &scene->mask;
+
+    // Layouts and build parameters go in too, a different build makes a different file
+    int params[6] = { CACHE_VERSION, (int)sizeof(struct GRFX_BVH_Node), BVH_LEAF_SIZE, BVH_MIN_BLOCKS, BVH_STACK_SIZE, SDF_KIND_SHIFT };
+    float size[4] = { scene->width, scene->height, cell, SDF_MAX_DIST };
+    int counts[4] = { scene->num_blocks, segs->count, circles->count, scene->polygons.num };
+    Uint64 hash = 0xcbf29ce484222325ull;
+
+    hash = GRFX_Hash(hash, params, sizeof(params));
+    hash = GRFX_Hash(hash, size, sizeof(size));
+    hash = GRFX_Hash(hash, counts, sizeof(counts));
+    hash = GRFX_Hash(hash, scene->blocks, scene->num_blocks * sizeof(SDL_FRect));
+    hash = GRFX_Hash(hash, segs->x1, segs->count * sizeof(float));
+    hash = GRFX_Hash(hash, segs->y1, segs->count * sizeof(float));
+    hash = GRFX_Hash(hash, segs->x2, segs->count * sizeof(float));
+    hash = GRFX_Hash(hash, segs->y2, segs->count * sizeof(float));
+    hash = GRFX_Hash(hash, circles->x, circles->count * sizeof(float));
+    hash = GRFX_Hash(hash, circles->y, circles->count * sizeof(float));
+    hash = GRFX_Hash(hash, circles->r, circles->count * sizeof(float));
+    hash = GRFX_Hash(hash, scene->polygons.first, scene->polygons.num * sizeof(int));
+    hash = GRFX_Hash(hash, scene->polygons.count, scene->polygons.num * sizeof(int));
+
+    if (mask->bits != NULL) {
+        float place[3] = { mask->x, mask->y, mask->cell };
+        int dims[3] = { mask->width, mask->height, mask->pitch };
+
+        hash = GRFX_Hash(hash, place, sizeof(place));
+        hash = GRFX_Hash(hash, dims, sizeof(dims));
+        hash = GRFX_Hash(hash, mask->bits, (size_t)mask->height * mask->pitch * sizeof(Uint64));
+    }
+
+    return hash;
+}
+
+// Map a whole file copy on write: pages are shared until the BVH refits or the field updates in place
+static void *GRFX_Cache_Map(const char *path, size_t *size) {
+#ifdef SDL_PLATFORM_WINDOWS
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER file_size;
+    void *memory = NULL;
+
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+        if (mapping != NULL) {
+            memory = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+    *size = (size_t)file_size.QuadPart;
+
+    return memory;
+#else
+    struct stat st;
+    void *memory = NULL;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        memory = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (memory == MAP_FAILED) memory = NULL;
+        *size = st.st_size;
+    }
+
+    close(fd);
+
+    return memory;
+#endif
+}
+
+static void GRFX_Cache_Unmap(void *memory, size_t size) {
+#ifdef SDL_PLATFORM_WINDOWS
+    (void)size;
+    UnmapViewOfFile(memory);
+#else
+    munmap(memory, size);
+#endif
+}
+
+// Reserve a section of size bytes at offset, returns where it starts. Sections start on CACHE_ALIGN boundaries.
+static Uint64 GRFX_Cache_Section(Uint64 *offset, Uint64 size) {
+    Uint64 start = *offset;
+    *offset += (size + CACHE_ALIGN - 1) / CACHE_ALIGN * CACHE_ALIGN;
+    return start;
+}
+
+// A section of count items of the given size fits inside the file and is aligned for them
+static bool GRFX_Cache_Fits(const struct GRFX_Cache_Header *header, Uint64 offset, Sint32 count, size_t size) {
+    return count >= 0 && offset % CACHE_ALIGN == 0 && offset <= header->size && (Uint64)count * size <= header->size - offset;
+}
+
+// Point the BVH and distance field into a mapped cache file, false when it doesn't belong to this scene
+static bool GRFX_Cache_Attach(struct GRFX_Scene *scene, Uint8 *memory, size_t size, Uint64 hash, float cell) {
+    const struct GRFX_Cache_Header *header = (const struct GRFX_Cache_Header *)memory;
+
+    if (size < sizeof(*header) || memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 || header->version != CACHE_VERSION ||
+        header->byte_order != CACHE_BYTE_ORDER || header->size != size || header->hash != hash || header->cell != cell) {
+        return false;
+    }
+
+    if (header->sdf_width < 0 || header->sdf_height < 0 || (header->sdf_height > 0 && header->sdf_width > SDL_MAX_SINT32 / header->sdf_height - 1)) {
+        return false;
+    }
+
+    Sint32 cells = header->sdf_width * header->sdf_height;
+
+    if (!GRFX_Cache_Fits(header, header->dist_offset, cells, sizeof(float)) ||
+        !GRFX_Cache_Fits(header, header->cell_start_offset, cells + 1, sizeof(int)) ||
+        !GRFX_Cache_Fits(header, header->cell_items_offset, header->sdf_items, sizeof(int)) ||
+        !GRFX_Cache_Fits(header, header->bvh_nodes_offset, header->bvh_nodes, sizeof(struct GRFX_BVH_Node)) ||
+        !GRFX_Cache_Fits(header, header->bvh_indices_offset, header->bvh_blocks, sizeof(int))) {
+        return false;
+    }
+
+    if (header->bvh_nodes > 0) {
+        struct GRFX_BVH *bvh = &scene->bvh;
+
+        GRFX_Destroy_BVH(bvh);
+        bvh->nodes = (struct GRFX_BVH_Node *)(memory + header->bvh_nodes_offset);
+        bvh->indices = (int *)(memory + header->bvh_indices_offset);
+        bvh->num_nodes = header->bvh_nodes;
+        bvh->num_blocks = header->bvh_blocks;
+        bvh->capacity = header->bvh_nodes;
+        bvh->build_cost = header->bvh_build_cost;
+        bvh->cost = header->bvh_cost;
+        bvh->mapped = true;
+    }
+
+    if (cells > 0) {
+        struct GRFX_SDF *sdf = &scene->sdf;
+
+        GRFX_Destroy_SDF(sdf);
+        sdf->width = header->sdf_width;
+        sdf->height = header->sdf_height;
+        sdf->cell = cell;
+        sdf->dist = (float *)(memory + header->dist_offset);
+        sdf->cell_start = (int *)(memory + header->cell_start_offset);
+        sdf->cell_items = (int *)(memory + header->cell_items_offset);
+        sdf->item_capacity = header->sdf_items;
+        sdf->row_out = malloc(cells * sizeof(float));
+        sdf->row_in = malloc(cells * sizeof(float));
+        sdf->mapped = true;
+    }
+
+    return true;
+}
+
+bool GRFX_Open_Cache(struct GRFX_Scene *scene, const char *path, float cell, struct GRFX_Workers *workers) {
+    Uint64 hash = GRFX_Hash_Scene(scene, cell);
+    size_t size = 0;
+
+    // Whatever an older mapping still backs goes first
+    if (scene->cache != NULL) {
+        if (scene->bvh.mapped) GRFX_Destroy_BVH(&scene->bvh);
+        if (scene->sdf.mapped) GRFX_Destroy_SDF(&scene->sdf);
+        GRFX_Close_Cache(scene);
+    }
+
+    Uint8 *memory = GRFX_Cache_Map(path, &size);
+
+    if (memory != NULL && GRFX_Cache_Attach(scene, memory, size, hash, cell)) {
+        scene->cache = memory;
+        scene->cache_size = size;
+        return true;
+    }
+
+    if (memory != NULL) GRFX_Cache_Unmap(memory, size);
+
+    GRFX_Update_BVH(scene);
+    if (cell > 0) GRFX_Build_SDF(scene, cell, workers);
+
+    // Not being able to write the cache only costs the next start its time
+    GRFX_Save_Cache(scene, path);
+
+    return false;
+}
+
+// Write size bytes and zeros up to the next CACHE_ALIGN boundary, keeping offset in step
+static bool GRFX_Cache_Write(FILE *file, const void *data, size_t size, Uint64 *offset) {
+    static const Uint8 zeros[CACHE_ALIGN];
+    size_t pad = (CACHE_ALIGN - size % CACHE_ALIGN) % CACHE_ALIGN;
+
+    *offset += size + pad;
+
+    return fwrite(data, 1, size, file) == size && fwrite(zeros, 1, pad, file) == pad;
+}
+
+bool GRFX_Save_Cache(const struct GRFX_Scene *scene, const char *path) {
+    const struct GRFX_BVH *bvh = &scene->bvh;
+    const struct GRFX_SDF *sdf = &scene->sdf;
+    struct GRFX_Cache_Header header;
+    bool have_bvh = bvh->num_nodes > 0 && bvh->num_blocks == scene->num_blocks;
+    bool have_sdf = sdf->dist != NULL && !sdf->has_dirty;
+    Sint32 cells = have_sdf ? sdf->width * sdf->height : 0;
+    Uint64 offset = 0;
+    char temp[1024];
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.cell = have_sdf ? sdf->cell : 0;
+    header.hash = GRFX_Hash_Scene(scene, header.cell);
+    GRFX_Cache_Section(&offset, sizeof(header));
+
+    if (have_sdf) {
+        header.sdf_width = sdf->width;
+        header.sdf_height = sdf->height;
+        header.sdf_items = sdf->cell_start[cells];
+        header.dist_offset = GRFX_Cache_Section(&offset, (Uint64)cells * sizeof(float));
+        header.cell_start_offset = GRFX_Cache_Section(&offset, (Uint64)(cells + 1) * sizeof(int));
+        header.cell_items_offset = GRFX_Cache_Section(&offset, (Uint64)header.sdf_items * sizeof(int));
+    }
+
+    if (have_bvh) {
+        header.bvh_nodes = bvh->num_nodes;
+        header.bvh_blocks = bvh->num_blocks;
+        header.bvh_build_cost = bvh->build_cost;
+        header.bvh_cost = bvh->cost;
+        header.bvh_nodes_offset = GRFX_Cache_Section(&offset, (Uint64)bvh->num_nodes * sizeof(struct GRFX_BVH_Node));
+        header.bvh_indices_offset = GRFX_Cache_Section(&offset, (Uint64)bvh->num_blocks * sizeof(int));
+    }
+
+    header.size = offset;
+
+    // Written beside the old file and renamed over it, so a reader never maps half a cache. The temp name is
+    // unique to the process and thread, so workers saving the same path don't write into one file.
+#ifdef SDL_PLATFORM_WINDOWS
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = (unsigned long)getpid();
+#endif
+    SDL_snprintf(temp, sizeof(temp), "%s.%lu.%llu.tmp", path, pid, (unsigned long long)SDL_GetCurrentThreadID());
+    FILE *file = fopen(temp, "wb");
+    if (file == NULL) return SDL_SetError("Could not write cache %s", temp);
+
+    offset = 0;
+    bool ok = GRFX_Cache_Write(file, &header, sizeof(header), &offset);
+
+    if (have_sdf) {
+        ok = ok && GRFX_Cache_Write(file, sdf->dist, (size_t)cells * sizeof(float), &offset);
+        ok = ok && GRFX_Cache_Write(file, sdf->cell_start, (size_t)(cells + 1) * sizeof(int), &offset);
+        ok = ok && GRFX_Cache_Write(file, sdf->cell_items, (size_t)header.sdf_items * sizeof(int), &offset);
+    }
+
+    if (have_bvh) {
+        ok = ok && GRFX_Cache_Write(file, bvh->nodes, (size_t)bvh->num_nodes * sizeof(struct GRFX_BVH_Node), &offset);
+        ok = ok && GRFX_Cache_Write(file, bvh->indices, (size_t)bvh->num_blocks * sizeof(int), &offset);
+    }
+
+    ok = fclose(file) == 0 && ok && offset == header.size;
+
+#ifdef SDL_PLATFORM_WINDOWS
+    // Windows won't rename over an existing file
+    if (ok) remove(path);
+#endif
+
+    if (!ok || rename(temp, path) != 0) {
+        remove(temp);
+        return SDL_SetError("Could not write cache %s", path);
+    }
+
+    return true;
+}
+
+void GRFX_Close_Cache(struct GRFX_Scene *scene) {
+    if (scene->cache == NULL) return;
+
+    GRFX_Cache_Unmap(scene->cache, scene->cache_size);
+    scene->cache = NULL;
+    scene->cache_size = 0;
+}
+
+#pragma endregion Cache Def
@@ -0,0 +1,320 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region GI Def
+
+// Radiance of the light's disk
+#define GI_EMISSION 1.0f
+
+// One cascade's rows to trace or shade, and the grown edit region when only part of it is traced
+struct GRFX_GI_Job {
+    struct GRFX_GI *gi;
+    const struct GRFX_Scene *scene;
+    int cascade;
+    SDL_FRect dirty;
+    bool all;
+};
+
+static void GRFX_GI_Free(struct GRFX_GI *gi) {
+    for (int i = 0; i < gi->num_cascades; i++) {
+        struct GRFX_GI_Cascade *c = &gi->cascades[i];
+
+        free(c->dir_x);
+        free(c->dir_y);
+        free(c->t_hit);
+        free(c->radiance);
+    }
+
+    free(gi->fluence);
+    free(gi->next);
+    gi->num_cascades = 0;
+    gi->fluence = NULL;
+    gi->next = NULL;
+}
+
+// Lay the probes out over a new domain, with cascades added until their intervals reach across it
+static void GRFX_GI_Layout(struct GRFX_GI *gi, SDL_FRect domain) {
+    float spacing = domain.w / GI_PROBES_X;
+    float reach = sqrtf(domain.w * domain.w + domain.h * domain.h);
+    float start = 0, length = spacing;
+
+    GRFX_GI_Free(gi);
+    gi->domain = domain;
+
+    while (gi->num_cascades < GI_MAX_CASCADES && start < reach) {
+        struct GRFX_GI_Cascade *c = &gi->cascades[gi->num_cascades];
+
+        c->spacing = spacing * (1 << gi->num_cascades);
+        c->width = (int)ceilf(domain.w / c->spacing);
+        c->height = (int)ceilf(domain.h / c->spacing);
+        c->dirs = 4 << (2 * gi->num_cascades);
+        c->start = start;
+        c->end = start + length;
+
+        size_t count = (size_t)c->width * c->height * c->dirs;
+        c->dir_x = malloc(c->dirs * sizeof(float));
+        c->dir_y = malloc(c->dirs * sizeof(float));
+        c->t_hit = malloc(count * sizeof(float));
+        c->radiance = malloc(count * sizeof(float));
+
+        // Direction j of a cascade splits into 4j to 4j + 3 of the next one
+        for (int j = 0; j < c->dirs; j++) {
+            float angle = (j + 0.5f) * 2 * (float)M_PI / c->dirs;
+            c->dir_x[j] = cosf(angle);
+            c->dir_y[j] = sinf(angle);
+        }
+
+        start = c->end;
+        length *= 4;
+        gi->num_cascades++;
+    }
+
+    // Out of cascades, the last one reaches the rest of the way
+    gi->cascades[gi->num_cascades - 1].end = fmaxf(start, reach);
+
+    size_t probes = (size_t)gi->cascades[0].width * gi->cascades[0].height;
+    gi->fluence = calloc(probes, sizeof(float));
+    gi->next = malloc(probes * sizeof(float));
+}
+
+// March the distance field from start to end along a ray, returns where it first enters an occluder's cell or
+// INFINITY. Near surfaces it creeps half a cell at a time, GI doesn't need the tracer's exact hits.
+static float GRFX_GI_March(const struct GRFX_SDF *sdf, float x, float y, float dx, float dy, float start, float end) {
+    float t = start, t_hit = INFINITY;
+    int steps = 0;
+
+    while (t < end) {
+        int cx = (int)floorf((x + t * dx) / sdf->cell), cy = (int)floorf((y + t * dy) / sdf->cell);
+
+        // Light that leaves the scene never comes back
+        if (cx < 0 || cx >= sdf->width || cy < 0 || cy >= sdf->height) break;
+
+        float dist = sdf->dist[cy * sdf->width + cx];
+        steps++;
+
+        if (dist < 0) {
+            t_hit = t;
+            break;
+        }
+
+        t += fmaxf(dist - sdf->cell, 0.5f * sdf->cell);
+    }
+
+    GRFX_STAT_ADD(gi_steps, steps);
+
+    return t_hit;
+}
+
+// Where a ray first meets the light's disk between start and end, or INFINITY
+static float GRFX_GI_Light(const struct GRFX_GI *gi, float x, float y, float dx, float dy, float start, float end) {
+    float ox = x - gi->light_x, oy = y - gi->light_y;
+    float b = ox * dx + oy * dy;
+    float d = b * b - (ox * ox + oy * oy - gi->light_r * gi->light_r);
+
+    if (d < 0) return INFINITY;
+
+    float t0 = -b - sqrtf(d), t1 = -b + sqrtf(d);
+    if (t1 < start || t0 > end) return INFINITY;
+
+    return fmaxf(t0, start);
+}
+
+// Bilinear weights and clamped indices of the two probes of a cascade bracketing a position along one axis
+static inline void GRFX_GI_Bracket(float position, float spacing, int n, int *i0, int *i1, float *w) {
+    float f = position / spacing - 0.5f;
+    int i = (int)floorf(f);
+
+    *w = f - i;
+    *i0 = SDL_clamp(i, 0, n - 1);
+    *i1 = SDL_clamp(i + 1, 0, n - 1);
+}
+
+// Last pass's fluence at a point, read from the cascade 0 probes around it
+static float GRFX_GI_Fluence(const struct GRFX_GI *gi, float x, float y) {
+    const struct GRFX_GI_Cascade *c = &gi->cascades[0];
+    int x0, x1, y0, y1;
+    float wx, wy;
+
+    GRFX_GI_Bracket(x - gi->domain.x, c->spacing, c->width, &x0, &x1, &wx);
+    GRFX_GI_Bracket(y - gi->domain.y, c->spacing, c->height, &y0, &y1, &wy);
+
+    const float *f = gi->fluence;
+    float top = f[y0 * c->width + x0] * (1 - wx) + f[y0 * c->width + x1] * wx;
+    float bottom = f[y1 * c->width + x0] * (1 - wx) + f[y1 * c->width + x1] * wx;
+
+    return top * (1 - wy) + bottom * wy;
+}
+
+// Worker job: march the intervals of one row of a cascade's probes, only those crossing the edit unless all are
+static void GRFX_GI_Trace(void *data, int index, int thread) {
+    (void)thread;
+    struct GRFX_GI_Job *job = data;
+    struct GRFX_GI *gi = job->gi;
+    struct GRFX_GI_Cascade *c = &gi->cascades[job->cascade];
+    float y = gi->domain.y + (index + 0.5f) * c->spacing;
+
+    for (int px = 0; px < c->width; px++) {
+        float x = gi->domain.x + (px + 0.5f) * c->spacing;
+        float *t_hit = c->t_hit + ((size_t)index * c->width + px) * c->dirs;
+
+        for (int j = 0; j < c->dirs; j++) {
+            float dx = c->dir_x[j], dy = c->dir_y[j];
+
+            if (!job->all) {
+                float x1 = x + c->start * dx, y1 = y + c->start * dy, x2 = x + c->end * dx, y2 = y + c->end * dy;
+                if (!MAF_Clip_Segment(&job->dirty, &x1, &y1, &x2, &y2)) continue;
+            }
+
+            t_hit[j] = GRFX_GI_March(&job->scene->sdf, x, y, dx, dy, c->start, c->end);
+        }
+    }
+}
+
+// Worker job: radiance along every interval of one row of a cascade's probes. An interval that reaches the light
+// sees it, one that stops at a surface sees the light the surface reflects, and one that is clear sees what the
+// four nearest probes of the cascade above see in the directions it splits into.
+static void GRFX_GI_Shade(void *data, int index, int thread) {
+    (void)thread;
+    struct GRFX_GI_Job *job = data;
+    struct GRFX_GI *gi = job->gi;
+    struct GRFX_GI_Cascade *c = &gi->cascades[job->cascade];
+    const struct GRFX_GI_Cascade *up = job->cascade + 1 < gi->num_cascades ? c + 1 : NULL;
+    float y = gi->domain.y + (index + 0.5f) * c->spacing;
+    float back = gi->cascades[0].spacing;
+    int ux0 = 0, ux1 = 0, uy0 = 0, uy1 = 0;
+    float wx = 0, wy = 0;
+
+    if (up != NULL) GRFX_GI_Bracket(y - gi->domain.y, up->spacing, up->height, &uy0, &uy1, &wy);
+
+    for (int px = 0; px < c->width; px++) {
+        float x = gi->domain.x + (px + 0.5f) * c->spacing;
+        size_t probe = ((size_t)index * c->width + px) * c->dirs;
+        const float *r00 = NULL, *r01 = NULL, *r10 = NULL, *r11 = NULL;
+
+        if (up != NULL) {
+            GRFX_GI_Bracket(x - gi->domain.x, up->spacing, up->width, &ux0, &ux1, &wx);
+            r00 = up->radiance + ((size_t)uy0 * up->width + ux0) * up->dirs;
+            r01 = up->radiance + ((size_t)uy0 * up->width + ux1) * up->dirs;
+            r10 = up->radiance + ((size_t)uy1 * up->width + ux0) * up->dirs;
+            r11 = up->radiance + ((size_t)uy1 * up->width + ux1) * up->dirs;
+        }
+
+        // Most probes are too far from the light for any interval to reach it
+        float lx = x - gi->light_x, ly = y - gi->light_y, lr = c->end + gi->light_r;
+        bool near_light = lx * lx + ly * ly < lr * lr;
+
+        for (int j = 0; j < c->dirs; j++) {
+            float dx = c->dir_x[j], dy = c->dir_y[j];
+            float t_hit = c->t_hit[probe + j];
+            float t_light = near_light ? GRFX_GI_Light(gi, x, y, dx, dy, c->start, fminf(t_hit, c->end)) : INFINITY;
+            float radiance = 0;
+
+            if (t_light < INFINITY) {
+                radiance = GI_EMISSION;
+            } else if (t_hit < INFINITY) {
+                // Read the light arriving just in front of the surface
+                radiance = GI_ALBEDO * GRFX_GI_Fluence(gi, x + (t_hit - back) * dx, y + (t_hit - back) * dy);
+            } else if (up != NULL) {
+                int k = 4 * j;
+                float s00 = r00[k] + r00[k + 1] + r00[k + 2] + r00[k + 3];
+                float s01 = r01[k] + r01[k + 1] + r01[k + 2] + r01[k + 3];
+                float s10 = r10[k] + r10[k + 1] + r10[k + 2] + r10[k + 3];
+                float s11 = r11[k] + r11[k + 1] + r11[k + 2] + r11[k + 3];
+
+                radiance = 0.25f * ((s00 * (1 - wx) + s01 * wx) * (1 - wy) + (s10 * (1 - wx) + s11 * wx) * wy);
+            }
+
+            c->radiance[probe + j] = radiance;
+        }
+    }
+}
+
+// Worker job: fluence of one row of cascade 0 probes, the average radiance over their directions
+static void GRFX_GI_Gather(void *data, int index, int thread) {
+    (void)thread;
+    struct GRFX_GI_Job *job = data;
+    struct GRFX_GI *gi = job->gi;
+    const struct GRFX_GI_Cascade *c = &gi->cascades[0];
+
+    for (int px = 0; px < c->width; px++) {
+        const float *radiance = c->radiance + ((size_t)index * c->width + px) * c->dirs;
+        float sum = 0;
+
+        for (int j = 0; j < c->dirs; j++) sum += radiance[j];
+        gi->next[index * c->width + px] = sum / c->dirs;
+    }
+}
+
+void GRFX_Invalidate_GI(struct GRFX_GI *gi, const SDL_FRect *region) {
+    if (region == NULL) {
+        gi->dirty_all = true;
+    } else if (!gi->has_dirty) {
+        gi->dirty = *region;
+    } else {
+        SDL_GetRectUnionFloat(&gi->dirty, region, &gi->dirty);
+    }
+
+    gi->has_dirty = true;
+}
+
+bool GRFX_Update_GI(struct GRFX_GI *gi, const struct GRFX_Scene *scene, SDL_FRect domain, struct GRFX_Workers *workers) {
+    struct GRFX_GI_Job job = { gi, scene, 0, gi->dirty, gi->dirty_all };
+
+    if (scene->sdf.dist == NULL || domain.w <= 0 || domain.h <= 0) return false;
+
+    // Probes move with the domain, so every interval is marched again
+    if (gi->num_cascades == 0 || !SDL_RectsEqualFloat(&domain, &gi->domain)) {
+        GRFX_GI_Layout(gi, domain);
+        job.all = true;
+    }
+
+    if (job.all || gi->has_dirty) {
+        // Marching reads distances up to SDF_MAX_DIST from the edit, and those changed too
+        job.dirty.x -= SDF_MAX_DIST;
+        job.dirty.y -= SDF_MAX_DIST;
+        job.dirty.w += 2 * SDF_MAX_DIST;
+        job.dirty.h += 2 * SDF_MAX_DIST;
+
+        for (job.cascade = 0; job.cascade < gi->num_cascades; job.cascade++) {
+            GRFX_Parallel_For(workers, gi->cascades[job.cascade].height, GRFX_GI_Trace, &job);
+        }
+
+        gi->dirty_all = false;
+        gi->has_dirty = false;
+        gi->passes = GI_PASSES;
+    }
+
+    // The light is tested as the intervals are shaded, moving it only needs new passes
+    if (scene->light_x != gi->light_x || scene->light_y != gi->light_y || scene->light_r != gi->light_r) {
+        gi->light_x = scene->light_x;
+        gi->light_y = scene->light_y;
+        gi->light_r = scene->light_r;
+        gi->passes = GI_PASSES;
+    }
+
+    if (gi->passes == 0) return false;
+
+    // Top cascade first, every one below reads the one above
+    for (job.cascade = gi->num_cascades - 1; job.cascade >= 0; job.cascade--) {
+        GRFX_Parallel_For(workers, gi->cascades[job.cascade].height, GRFX_GI_Shade, &job);
+    }
+
+    GRFX_Parallel_For(workers, gi->cascades[0].height, GRFX_GI_Gather, &job);
+
+    float *fluence = gi->fluence;
+    gi->fluence = gi->next;
+    gi->next = fluence;
+    gi->passes--;
+
+    return true;
+}
+
+void GRFX_Destroy_GI(struct GRFX_GI *gi) {
+    GRFX_GI_Free(gi);
+    memset(gi, 0, sizeof(*gi));
+}
+
+#pragma endregion GI Def
@@ -0,0 +1,94 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Heatmap Def
+
+struct GRFX_Heatmap GRFX_Create_Heatmap(int width, int height, int cell) {
+    struct GRFX_Heatmap heatmap;
+
+    memset(&heatmap, 0, sizeof(heatmap));
+    heatmap.cell = cell;
+    heatmap.width = (width + cell - 1) / cell;
+    heatmap.height = (height + cell - 1) / cell;
+    heatmap.cost = calloc((size_t)heatmap.width * heatmap.height, sizeof(float));
+
+    return heatmap;
+}
+
+void GRFX_Destroy_Heatmap(struct GRFX_Heatmap *heatmap) {
+    free(heatmap->cost);
+    memset(heatmap, 0, sizeof(*heatmap));
+}
+
+void GRFX_Heatmap_Begin(struct GRFX_Heatmap *heatmap) {
+    memset(heatmap->cost, 0, (size_t)heatmap->width * heatmap->height * sizeof(float));
+    heatmap->max = 0;
+}
+
+void GRFX_Heatmap_Add(struct GRFX_Heatmap *heatmap, float x1, float y1, float x2, float y2, float cost) {
+    SDL_FRect rect = { 0, 0, (float)heatmap->width * heatmap->cell, (float)heatmap->height * heatmap->cell };
+    float length = hypotf(x2 - x1, y2 - y1);
+
+    // Endpoints that aren't finite numbers would make the cell walk below run practically forever
+    if (!isfinite(x1) || !isfinite(y1) || !isfinite(x2) || !isfinite(y2)) return;
+
+    // Only the part inside the map is walked, with its share of the cost
+    if (!MAF_Clip_Segment(&rect, &x1, &y1, &x2, &y2)) return;
+    if (length > 0) cost *= hypotf(x2 - x1, y2 - y1) / length;
+
+    float cell = (float)heatmap->cell, dx = x2 - x1, dy = y2 - y1;
+    int cx = (int)floorf(x1 / cell), cy = (int)floorf(y1 / cell);
+    int n = abs((int)floorf(x2 / cell) - cx) + abs((int)floorf(y2 / cell) - cy);
+    int sx = dx > 0 ? 1 : -1, sy = dy > 0 ? 1 : -1;
+
+    // Walk the cells in the order the segment crosses them, t runs from 0 to 1 along it
+    float step_x = dx != 0 ? cell / fabsf(dx) : INFINITY, step_y = dy != 0 ? cell / fabsf(dy) : INFINITY;
+    float tx = dx != 0 ? (sx > 0 ? (cx + 1) * cell - x1 : x1 - cx * cell) / fabsf(dx) : INFINITY;
+    float ty = dy != 0 ? (sy > 0 ? (cy + 1) * cell - y1 : y1 - cy * cell) / fabsf(dy) : INFINITY;
+
+    // Each cell gets the cost in proportion to the length of the segment inside it, so long cheap segments don't outweigh short costly ones
+    float t = 0;
+
+    for (int i = 0; i <= n; i++) {
+        float next = i == n ? 1 : SDL_min(SDL_min(tx, ty), 1);
+
+        if (cx >= 0 && cx < heatmap->width && cy >= 0 && cy < heatmap->height && next > t) {
+            float *c = &heatmap->cost[cy * heatmap->width + cx];
+            *c += cost * (next - t);
+            if (*c > heatmap->max) heatmap->max = *c;
+        }
+
+        t = SDL_max(t, next);
+
+        if (tx < ty) {
+            tx += step_x;
+            cx += sx;
+        } else {
+            ty += step_y;
+            cy += sy;
+        }
+    }
+}
+
+void GRFX_Heatmap_Colors(const struct GRFX_Heatmap *heatmap, SDL_Color *colors) {
+    // Costs span orders of magnitude, a log scale keeps the cheap regions from all looking the same
+    float scale = heatmap->max > 0 ? 1 / log1pf(heatmap->max) : 0;
+
+    for (int i = 0; i < heatmap->width * heatmap->height; i++) {
+        float v = log1pf(heatmap->cost[i]) * scale;
+
+        // Transparent where nothing passed, then blue through red to yellow
+        if (heatmap->cost[i] <= 0) {
+            colors[i] = (SDL_Color){ 0, 0, 0, 0 };
+        } else if (v < 0.5f) {
+            colors[i] = (SDL_Color){ (Uint8)(510 * v), 0, (Uint8)(255 - 510 * v), (Uint8)(64 + 128 * v) };
+        } else {
+            colors[i] = (SDL_Color){ 255, (Uint8)(510 * (v - 0.5f)), 0, (Uint8)(64 + 128 * v) };
+        }
+    }
+}
+
+#pragma endregion Heatmap Def
@@ -0,0 +1,204 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Light Cache Def
+
+// One grid row to bake, each job traces into its own row buffer
+struct GRFX_Light_Job {
+    struct GRFX_Light_Cache *cache;
+    const struct GRFX_Scene *scene;
+    const struct GRFX_Ray_Query *fan;
+    struct GRFX_Ray_Segment **rows;
+    int *row_counts;
+};
+
+// Everything a baked path depends on besides the light: the occluders and which blocks are glass
+static Uint64 GRFX_Light_Key(const struct GRFX_Scene *scene) {
+    Uint64 key = GRFX_Hash_Scene(scene, 0);
+
+    for (int i = 0; i < scene->num_blocks; i++) {
+        Uint32 bits;
+        memcpy(&bits, &scene->block_ior[i], sizeof(bits));
+        key = (key ^ bits) * 0x100000001b3ull;
+    }
+
+    return key;
+}
+
+// Worker job: trace the fan from every grid point of one row
+static void GRFX_Light_Row(void *data, int gy, int thread) {
+    (void)thread;
+    struct GRFX_Light_Job *job = data;
+    struct GRFX_Light_Cache *cache = job->cache;
+    struct GRFX_Ray_Pool pool = GRFX_Create_Ray_Pool(RAY_POOL_SIZE);
+    struct GRFX_Ray_Segment *out = malloc(RAY_POOL_SIZE * sizeof(struct GRFX_Ray_Segment));
+    struct GRFX_Ray_Query *rays = malloc(cache->num_rays * sizeof(struct GRFX_Ray_Query));
+    struct GRFX_Ray_Segment *row = NULL;
+    int count = 0, capacity = 0;
+
+    for (int gx = 0; gx < cache->width && out != NULL && rays != NULL; gx++) {
+        for (int i = 0; i < cache->num_rays; i++) {
+            rays[i] = (struct GRFX_Ray_Query){ cache->bounds.x + gx * cache->cell, cache->bounds.y + gy * cache->cell, job->fan[i].dx, job->fan[i].dy };
+        }
+
+        int n = GRFX_Trace_Rays(job->scene, &pool, rays, cache->num_rays, cache->depth, out, RAY_POOL_SIZE);
+
+        if (count + n > capacity) {
+            capacity = SDL_max(2 * capacity, count + n);
+            row = realloc(row, capacity * sizeof(struct GRFX_Ray_Segment));
+        }
+
+        memcpy(row + count, out, n * sizeof(struct GRFX_Ray_Segment));
+        count += n;
+        cache->first[gy * cache->width + gx] = n;
+    }
+
+    job->rows[gy] = row;
+    job->row_counts[gy] = count;
+
+    GRFX_Destroy_Ray_Pool(&pool);
+    free(out);
+    free(rays);
+}
+
+void GRFX_Bake_Light_Cache(struct GRFX_Light_Cache *cache, const struct GRFX_Scene *scene, SDL_FRect bounds, float cell, int num_rays, int depth, struct GRFX_Workers *workers) {
+    GRFX_Destroy_Light_Cache(cache);
+
+    cache->bounds = bounds;
+    cache->cell = cell;
+    cache->width = (int)ceilf(bounds.w / cell) + 1;
+    cache->height = (int)ceilf(bounds.h / cell) + 1;
+    cache->num_rays = num_rays;
+    cache->depth = depth;
+    cache->key = GRFX_Light_Key(scene);
+    cache->first = calloc((size_t)cache->width * cache->height + 1, sizeof(int));
+
+    // The same fan the app traces: num_rays directions evenly spaced from +x
+    struct GRFX_Ray_Query *fan = malloc(num_rays * sizeof(struct GRFX_Ray_Query));
+    struct GRFX_Light_Job job = { cache, scene, fan, calloc(cache->height, sizeof(struct GRFX_Ray_Segment *)), calloc(cache->height, sizeof(int)) };
+    double rad = 0;
+
+    for (int i = 0; i < num_rays; i++) {
+        fan[i] = (struct GRFX_Ray_Query){ 0, 0, cos(rad), sin(rad) };
+        rad += 2 * M_PI / num_rays;
+    }
+
+    GRFX_Parallel_For(workers, cache->height, GRFX_Light_Row, &job);
+
+    // Rows go back to back, and every grid point's count becomes its offset
+    size_t total = 0;
+    for (int gy = 0; gy < cache->height; gy++) total += job.row_counts[gy];
+
+    cache->segments = malloc(SDL_max(total, 1) * sizeof(struct GRFX_Ray_Segment));
+    cache->num_segments = 0;
+
+    for (int gy = 0; gy < cache->height; gy++) {
+        memcpy(cache->segments + cache->num_segments, job.rows[gy], job.row_counts[gy] * sizeof(struct GRFX_Ray_Segment));
+        cache->num_segments += job.row_counts[gy];
+        free(job.rows[gy]);
+    }
+
+    int offset = 0;
+    for (int i = 0; i <= cache->width * cache->height; i++) {
+        int n = cache->first[i];
+        cache->first[i] = offset;
+        offset += n;
+    }
+
+    free(job.rows);
+    free(job.row_counts);
+    free(fan);
+}
+
+bool GRFX_Light_Cache_Valid(const struct GRFX_Light_Cache *cache, const struct GRFX_Scene *scene, SDL_FRect bounds, int num_rays, int depth) {
+    return cache->segments != NULL && cache->num_rays == num_rays && cache->depth == depth && bounds.x >= cache->bounds.x && bounds.y >= cache->bounds.y &&
+        bounds.x + bounds.w <= cache->bounds.x + cache->bounds.w && bounds.y + bounds.h <= cache->bounds.y + cache->bounds.h && cache->key == GRFX_Light_Key(scene);
+}
+
+int GRFX_Lookup_Light_Cache(const struct GRFX_Light_Cache *cache, float x, float y, struct GRFX_Ray_Segment *out, int max_out) {
+    float u = (x - cache->bounds.x) / cache->cell, v = (y - cache->bounds.y) / cache->cell;
+
+    if (cache->segments == NULL || !(u >= 0 && v >= 0 && u <= cache->width - 1 && v <= cache->height - 1)) return -1;
+
+    int gx = SDL_min((int)u, cache->width - 2), gy = SDL_min((int)v, cache->height - 2);
+    float fx = u - gx, fy = v - gy;
+
+    // A 1 point wide grid has no second column or row, it is its own neighbour
+    gx = SDL_max(gx, 0), gy = SDL_max(gy, 0);
+    int x1 = SDL_min(gx + 1, cache->width - 1), y1 = SDL_min(gy + 1, cache->height - 1);
+    int corners[4] = { gy * cache->width + gx, gy * cache->width + x1, y1 * cache->width + gx, y1 * cache->width + x1 };
+    float weights[4] = { (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+    int at[4], end[4], nearest = 0, num_out = 0;
+
+    for (int c = 0; c < 4; c++) {
+        at[c] = cache->first[corners[c]];
+        end[c] = cache->first[corners[c] + 1];
+        if (weights[c] > weights[nearest]) nearest = c;
+    }
+
+    // Segments come ray by ray. A ray whose path hits the same things in the same order from all four
+    // corners is blended between them, any other is taken from the nearest corner as it was baked.
+    for (int ray = 0; ray < cache->num_rays; ray++) {
+        int len[4];
+        bool same = true;
+
+        for (int c = 0; c < 4; c++) {
+            len[c] = 0;
+            while (at[c] + len[c] < end[c] && cache->segments[at[c] + len[c]].ray == ray) len[c]++;
+            same = same && len[c] == len[0];
+        }
+
+        for (int k = 0; k < len[0] && same; k++) {
+            const struct GRFX_Ray_Segment *a = &cache->segments[at[0] + k];
+
+            for (int c = 1; c < 4 && same; c++) {
+                const struct GRFX_Ray_Segment *b = &cache->segments[at[c] + k];
+                same = a->hit_kind == b->hit_kind && a->hit_id == b->hit_id;
+            }
+        }
+
+        for (int k = 0; k < len[nearest] && num_out < max_out; k++) {
+            struct GRFX_Ray_Segment seg = cache->segments[at[nearest] + k];
+
+            if (same) {
+                seg.x1 = seg.y1 = seg.x2 = seg.y2 = seg.energy = 0;
+
+                // Corners with no weight are left out, so a point on the grid gets back exactly what was baked there
+                for (int c = 0; c < 4; c++) {
+                    if (weights[c] == 0) continue;
+
+                    const struct GRFX_Ray_Segment *s = &cache->segments[at[c] + k];
+                    seg.x1 += weights[c] * s->x1;
+                    seg.y1 += weights[c] * s->y1;
+                    seg.x2 += weights[c] * s->x2;
+                    seg.y2 += weights[c] * s->y2;
+                    seg.energy += weights[c] * s->energy;
+                }
+            }
+
+            // Every ray still leaves from the light itself
+            if (k == 0) seg.x1 = x, seg.y1 = y;
+
+            // Nothing was traced for it
+            seg.cost = 1;
+            out[num_out++] = seg;
+        }
+
+        for (int c = 0; c < 4; c++) at[c] += len[c];
+    }
+
+    GRFX_STAT_ADD(segments, num_out);
+
+    return num_out;
+}
+
+void GRFX_Destroy_Light_Cache(struct GRFX_Light_Cache *cache) {
+    free(cache->first);
+    free(cache->segments);
+    memset(cache, 0, sizeof(*cache));
+}
+
+#pragma endregion Light Cache Def
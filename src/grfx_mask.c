@@ -0,0 +1,61 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Mask Def
+
+bool GRFX_Set_Mask(struct GRFX_Scene *scene, SDL_Surface *surface, float x, float y, float cell) {
+    struct GRFX_Mask *mask = &scene->mask;
+
+    // Read every pixel as RGBA whatever the file stored
+    SDL_Surface *rgba = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+    if (rgba == NULL) return false;
+
+    GRFX_Destroy_Mask(mask);
+    mask->width = rgba->w;
+    mask->height = rgba->h;
+    mask->pitch = (rgba->w + 63) / 64;
+    mask->x = x;
+    mask->y = y;
+    mask->cell = cell;
+    mask->bits = calloc((size_t)mask->pitch * mask->height, sizeof(Uint64));
+
+    for (int cy = 0; cy < mask->height; cy++) {
+        const Uint8 *row = (const Uint8 *)rgba->pixels + cy * rgba->pitch;
+        Uint64 *bits = mask->bits + cy * mask->pitch;
+
+        for (int cx = 0; cx < mask->width; cx++) {
+            const Uint8 *p = row + cx * 4;
+            int luma = (p[0] * 299 + p[1] * 587 + p[2] * 114) / 1000;
+
+            if (p[3] >= 128 && luma < 128) bits[cx >> 6] |= (Uint64)1 << (cx & 63);
+        }
+    }
+
+    SDL_DestroySurface(rgba);
+
+    // A distance field files mask cells too
+    GRFX_Invalidate_SDF(scene, NULL);
+
+    return true;
+}
+
+bool GRFX_Load_Mask(struct GRFX_Scene *scene, const char *path, float x, float y, float cell) {
+    SDL_Surface *surface = SDL_LoadBMP(path);
+
+    if (surface == NULL) return false;
+
+    bool ok = GRFX_Set_Mask(scene, surface, x, y, cell);
+    SDL_DestroySurface(surface);
+
+    return ok;
+}
+
+void GRFX_Destroy_Mask(struct GRFX_Mask *mask) {
+    free(mask->bits);
+    memset(mask, 0, sizeof(*mask));
+}
+
+#pragma endregion Mask Def
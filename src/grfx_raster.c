@@ -0,0 +1,154 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Raster Def
+
+struct GRFX_Raster GRFX_Create_Raster(int width, int height) {
+    struct GRFX_Raster raster;
+
+    memset(&raster, 0, sizeof(raster));
+    raster.width = width;
+    raster.height = height;
+    raster.pitch = width * 4;
+    raster.pixels = malloc(raster.pitch * height);
+    raster.tiles_x = (width + RASTER_TILE - 1) / RASTER_TILE;
+    raster.tiles_y = (height + RASTER_TILE - 1) / RASTER_TILE;
+    raster.bin_start = malloc((raster.tiles_x * raster.tiles_y + 1) * sizeof(int));
+
+    return raster;
+}
+
+void GRFX_Destroy_Raster(struct GRFX_Raster *raster) {
+    free(raster->pixels);
+    free(raster->lines);
+    free(raster->bin_start);
+    free(raster->bins);
+    memset(raster, 0, sizeof(*raster));
+}
+
+void GRFX_Raster_Begin(struct GRFX_Raster *raster) {
+    raster->num_lines = 0;
+}
+
+void GRFX_Raster_Add_Line(struct GRFX_Raster *raster, float x1, float y1, float x2, float y2, SDL_Color color) {
+    if (raster->num_lines == raster->line_capacity) {
+        raster->line_capacity = raster->line_capacity ? raster->line_capacity * 2 : 1024;
+        raster->lines = realloc(raster->lines, raster->line_capacity * sizeof(struct GRFX_Raster_Line));
+    }
+
+    raster->lines[raster->num_lines++] = (struct GRFX_Raster_Line){ x1, y1, x2, y2, color };
+}
+
+// Pixels of a tile, grown by one so lines clipped on the border still reach its edge pixels
+static SDL_FRect GRFX_Raster_Tile_Rect(const struct GRFX_Raster *raster, int tile) {
+    int tx = tile % raster->tiles_x, ty = tile / raster->tiles_x;
+    return (SDL_FRect){ tx * RASTER_TILE - 1.0f, ty * RASTER_TILE - 1.0f, RASTER_TILE + 2.0f, RASTER_TILE + 2.0f };
+}
+
+// Run body for every tile a line crosses, with the line clipped to that tile in x1, y1, x2, y2.
+// The box is grown by a pixel since rounded steps can land just past the line's ends.
+#define RASTER_FOR_TILES(raster, line, tile, body) { \
+    int tx_min = SDL_max((int)floorf((fminf((line)->x1, (line)->x2) - 1) / RASTER_TILE), 0); \
+    int ty_min = SDL_max((int)floorf((fminf((line)->y1, (line)->y2) - 1) / RASTER_TILE), 0); \
+    int tx_max = SDL_min((int)floorf((fmaxf((line)->x1, (line)->x2) + 1) / RASTER_TILE), (raster)->tiles_x - 1); \
+    int ty_max = SDL_min((int)floorf((fmaxf((line)->y1, (line)->y2) + 1) / RASTER_TILE), (raster)->tiles_y - 1); \
+    for (int ty = ty_min; ty <= ty_max; ty++) { \
+        for (int tx = tx_min; tx <= tx_max; tx++) { \
+            int tile = ty * (raster)->tiles_x + tx; \
+            SDL_FRect rect = GRFX_Raster_Tile_Rect(raster, tile); \
+            float x1 = (line)->x1, y1 = (line)->y1, x2 = (line)->x2, y2 = (line)->y2; \
+            if (MAF_Clip_Segment(&rect, &x1, &y1, &x2, &y2)) body \
+        } \
+    } \
+}
+
+// Sort line indices into per-tile bins, keeping submission order inside every bin so blending matches a serial draw
+static void GRFX_Raster_Bin(struct GRFX_Raster *raster) {
+    int num_tiles = raster->tiles_x * raster->tiles_y;
+    int *start = raster->bin_start;
+    int total = 0;
+
+    memset(start, 0, (num_tiles + 1) * sizeof(int));
+
+    for (int i = 0; i < raster->num_lines; i++) {
+        const struct GRFX_Raster_Line *line = &raster->lines[i];
+        RASTER_FOR_TILES(raster, line, tile, { start[tile + 1]++; total++; })
+    }
+
+    if (total > raster->bin_capacity) {
+        raster->bin_capacity = total * 2;
+        raster->bins = realloc(raster->bins, raster->bin_capacity * sizeof(int));
+    }
+
+    for (int t = 0; t < num_tiles; t++) start[t + 1] += start[t];
+
+    // Fill using start as a running cursor, then shift it back into place
+    for (int i = 0; i < raster->num_lines; i++) {
+        const struct GRFX_Raster_Line *line = &raster->lines[i];
+        RASTER_FOR_TILES(raster, line, tile, { raster->bins[start[tile]++] = i; })
+    }
+
+    for (int t = num_tiles; t > 0; t--) start[t] = start[t - 1];
+    start[0] = 0;
+}
+
+// Clear one tile and draw its lines into it. Only this tile's pixels are written, so tiles never contend.
+static void GRFX_Raster_Tile(void *data, int tile, int thread) {
+    (void)thread;
+    struct GRFX_Raster *raster = data;
+    int x_min = (tile % raster->tiles_x) * RASTER_TILE, y_min = (tile / raster->tiles_x) * RASTER_TILE;
+    int x_max = SDL_min(x_min + RASTER_TILE, raster->width), y_max = SDL_min(y_min + RASTER_TILE, raster->height);
+    SDL_FRect rect = GRFX_Raster_Tile_Rect(raster, tile);
+
+    for (int y = y_min; y < y_max; y++) {
+        Uint8 *row = raster->pixels + y * raster->pitch;
+        for (int x = x_min; x < x_max; x++) {
+            row[x * 4] = 0, row[x * 4 + 1] = 0, row[x * 4 + 2] = 0, row[x * 4 + 3] = 255;
+        }
+    }
+
+    for (int b = raster->bin_start[tile]; b < raster->bin_start[tile + 1]; b++) {
+        const struct GRFX_Raster_Line *line = &raster->lines[raster->bins[b]];
+        float dx = line->x2 - line->x1, dy = line->y2 - line->y1;
+        float major = fmaxf(fabsf(dx), fabsf(dy));
+        int n = major > 1 ? (int)ceilf(major) : 1;
+        float x1 = line->x1, y1 = line->y1, x2 = line->x2, y2 = line->y2;
+        int a = line->color.a;
+
+        if (!MAF_Clip_Segment(&rect, &x1, &y1, &x2, &y2)) continue;
+
+        // Steps come from the whole line, so every tile samples the same points along it
+        float t0 = fabsf(dx) >= fabsf(dy) ? (dx != 0 ? (x1 - line->x1) / dx : 0) : (y1 - line->y1) / dy;
+        float t1 = fabsf(dx) >= fabsf(dy) ? (dx != 0 ? (x2 - line->x1) / dx : 1) : (y2 - line->y1) / dy;
+        int k_min = SDL_max((int)floorf(SDL_min(t0, t1) * n) - 1, 0);
+        int k_max = SDL_min((int)ceilf(SDL_max(t0, t1) * n), n);
+        int last_x = SDL_MIN_SINT32, last_y = SDL_MIN_SINT32;
+
+        for (int k = k_min; k <= k_max; k++) {
+            int x = (int)floorf(line->x1 + dx * k / n);
+            int y = (int)floorf(line->y1 + dy * k / n);
+
+            // Neighbouring steps can land on the same pixel, blend it once
+            if (x == last_x && y == last_y) continue;
+            last_x = x, last_y = y;
+
+            if (x < x_min || x >= x_max || y < y_min || y >= y_max) continue;
+
+            // Alpha blend over the pixel, like SDL_BLENDMODE_BLEND
+            Uint8 *p = raster->pixels + y * raster->pitch + x * 4;
+            p[0] = (line->color.r * a + p[0] * (255 - a) + 127) / 255;
+            p[1] = (line->color.g * a + p[1] * (255 - a) + 127) / 255;
+            p[2] = (line->color.b * a + p[2] * (255 - a) + 127) / 255;
+        }
+    }
+}
+
+void GRFX_Raster_Draw(struct GRFX_Raster *raster, struct GRFX_Workers *workers) {
+    GRFX_Raster_Bin(raster);
+    GRFX_Parallel_For(workers, raster->tiles_x * raster->tiles_y, GRFX_Raster_Tile, raster);
+}
+
+#pragma endregion Raster Def
@@ -0,0 +1,215 @@
+#pragma region Include
+
+#include "grfx.h"
+#include <SDL3/SDL_timer.h>
+
+#ifdef SDL_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#pragma endregion Include
+
+#pragma region Ring Def
+
+SDL_COMPILE_TIME_ASSERT(ring_header, sizeof(struct GRFX_Ring_Header) <= RING_HEADER_SIZE);
+SDL_COMPILE_TIME_ASSERT(ring_slot, sizeof(struct GRFX_Ring_Slot) <= RING_HEADER_SIZE);
+
+// Map size bytes of shared memory under the ring's name, creating them for the writer
+static bool GRFX_Ring_Map(struct GRFX_Ring *ring, size_t size) {
+#ifdef SDL_PLATFORM_WINDOWS
+    char path[80];
+    HANDLE handle;
+
+    SDL_snprintf(path, sizeof(path), "Local\\%s", ring->name);
+
+    if (ring->owner) {
+        handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((Uint64)size >> 32), (DWORD)size, path);
+    } else {
+        handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path);
+    }
+
+    if (handle == NULL) return SDL_SetError("Could not map %s (error %lu)", path, GetLastError());
+
+    ring->header = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (ring->header == NULL) {
+        CloseHandle(handle);
+        return SDL_SetError("Could not map %s (error %lu)", path, GetLastError());
+    }
+
+    // A reader finds the size in the header once it is mapped
+    if (size == 0) {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(ring->header, &info, sizeof(info));
+        size = info.RegionSize;
+    }
+
+    ring->handle = handle;
+#else
+    char path[80];
+    int fd;
+
+    SDL_snprintf(path, sizeof(path), "/%s", ring->name);
+
+    if (ring->owner) {
+        fd = shm_open(path, O_CREAT | O_RDWR | O_TRUNC, 0600);
+        if (fd >= 0 && ftruncate(fd, size) != 0) {
+            close(fd);
+            shm_unlink(path);
+            fd = -1;
+        }
+    } else {
+        struct stat st;
+
+        fd = shm_open(path, O_RDWR, 0);
+        if (fd >= 0 && fstat(fd, &st) == 0) size = st.st_size;
+    }
+
+    if (fd < 0) return SDL_SetError("Could not map %s: %s", path, strerror(errno));
+
+    // Readers map it writable too, so atomic loads work everywhere, but never write to it
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED) {
+        if (ring->owner) shm_unlink(path);
+        return SDL_SetError("Could not map %s: %s", path, strerror(errno));
+    }
+
+    ring->header = memory;
+#endif
+
+    ring->size = size;
+
+    return true;
+}
+
+bool GRFX_Ring_Create(struct GRFX_Ring *ring, const char *name, int num_slots, int max_segments, int max_width, int max_height) {
+    size_t slot_size = RING_HEADER_SIZE + (size_t)max_segments * sizeof(struct GRFX_Ray_Segment) + (size_t)max_width * max_height * 4;
+
+    // Keep every slot cache line aligned
+    slot_size = (slot_size + 63) & ~(size_t)63;
+
+    memset(ring, 0, sizeof(*ring));
+    SDL_strlcpy(ring->name, name, sizeof(ring->name));
+    ring->owner = true;
+
+    if (slot_size > SDL_MAX_UINT32) return SDL_SetError("Ring slots of %zu bytes are too big", slot_size);
+    if (!GRFX_Ring_Map(ring, RING_HEADER_SIZE + num_slots * slot_size)) return false;
+
+    struct GRFX_Ring_Header *header = ring->header;
+    header->version = RING_VERSION;
+    header->num_slots = num_slots;
+    header->slot_size = (Uint32)slot_size;
+    header->max_segments = max_segments;
+    header->max_width = max_width;
+    header->max_height = max_height;
+    SDL_SetAtomicU32(&header->frames, 0);
+
+    // Readers check the magic last, so they never see a half written header
+    SDL_MemoryBarrierRelease();
+    memcpy(header->magic, RING_MAGIC, sizeof(header->magic));
+
+    return true;
+}
+
+bool GRFX_Ring_Open(struct GRFX_Ring *ring, const char *name) {
+    memset(ring, 0, sizeof(*ring));
+    SDL_strlcpy(ring->name, name, sizeof(ring->name));
+
+    if (!GRFX_Ring_Map(ring, 0)) return false;
+
+    const struct GRFX_Ring_Header *header = ring->header;
+    SDL_MemoryBarrierAcquire();
+
+    if (ring->size < RING_HEADER_SIZE || memcmp(header->magic, RING_MAGIC, sizeof(header->magic)) != 0 || header->version != RING_VERSION ||
+        ring->size < RING_HEADER_SIZE + (size_t)header->num_slots * header->slot_size) {
+        GRFX_Ring_Close(ring);
+        return SDL_SetError("%s is not a version %d frame ring", name, RING_VERSION);
+    }
+
+    return true;
+}
+
+void GRFX_Ring_Close(struct GRFX_Ring *ring) {
+    if (ring->header == NULL) return;
+
+#ifdef SDL_PLATFORM_WINDOWS
+    UnmapViewOfFile(ring->header);
+    CloseHandle(ring->handle);
+#else
+    munmap(ring->header, ring->size);
+
+    // Readers that still have it mapped keep their mapping
+    if (ring->owner) {
+        char path[80];
+        SDL_snprintf(path, sizeof(path), "/%s", ring->name);
+        shm_unlink(path);
+    }
+#endif
+
+    memset(ring, 0, sizeof(*ring));
+}
+
+static struct GRFX_Ring_Slot *GRFX_Ring_Slot_At(const struct GRFX_Ring *ring, Uint32 frame) {
+    const struct GRFX_Ring_Header *header = ring->header;
+    return (struct GRFX_Ring_Slot *)((Uint8 *)header + RING_HEADER_SIZE + (size_t)(frame % header->num_slots) * header->slot_size);
+}
+
+struct GRFX_Ring_Slot *GRFX_Ring_Begin(struct GRFX_Ring *ring) {
+    Uint32 frame = GRFX_Ring_Frames(ring);
+    struct GRFX_Ring_Slot *slot = GRFX_Ring_Slot_At(ring, frame);
+
+    // Odd: readers of the frame that was here see it change under them
+    SDL_SetAtomicU32(&slot->seq, 2 * frame + 1);
+    SDL_MemoryBarrierRelease();
+
+    slot->frame = frame;
+    slot->time_ns = SDL_GetTicksNS();
+    slot->num_segments = 0;
+    slot->width = 0;
+    slot->height = 0;
+    slot->pitch = 0;
+    slot->format = SDL_PIXELFORMAT_UNKNOWN;
+
+    return slot;
+}
+
+void GRFX_Ring_End(struct GRFX_Ring *ring, struct GRFX_Ring_Slot *slot) {
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicU32(&slot->seq, 2 * slot->frame + 2);
+    SDL_SetAtomicU32(&ring->header->frames, slot->frame + 1);
+}
+
+Uint32 GRFX_Ring_Frames(const struct GRFX_Ring *ring) {
+    return SDL_GetAtomicU32(&ring->header->frames);
+}
+
+const struct GRFX_Ring_Slot *GRFX_Ring_Read_Begin(const struct GRFX_Ring *ring, Uint32 frame) {
+    struct GRFX_Ring_Slot *slot = GRFX_Ring_Slot_At(ring, frame);
+
+    if (SDL_GetAtomicU32(&slot->seq) != 2 * frame + 2) return NULL;
+    SDL_MemoryBarrierAcquire();
+
+    return slot;
+}
+
+bool GRFX_Ring_Read_End(const struct GRFX_Ring_Slot *slot, Uint32 frame) {
+    SDL_MemoryBarrierAcquire();
+    return SDL_GetAtomicU32((SDL_AtomicU32 *)&slot->seq) == 2 * frame + 2;
+}
+
+struct GRFX_Ray_Segment *GRFX_Ring_Segments(const struct GRFX_Ring_Slot *slot) {
+    return (struct GRFX_Ray_Segment *)((Uint8 *)slot + RING_HEADER_SIZE);
+}
+
+Uint8 *GRFX_Ring_Pixels(const struct GRFX_Ring *ring, const struct GRFX_Ring_Slot *slot) {
+    return (Uint8 *)GRFX_Ring_Segments(slot) + (size_t)ring->header->max_segments * sizeof(struct GRFX_Ray_Segment);
+}
+
+#pragma endregion Ring Def
@@ -0,0 +1,330 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Scene Def
+
+struct GRFX_Scene GRFX_Create_Scene(float width, float height) {
+    struct GRFX_Scene scene;
+
+    memset(&scene, 0, sizeof(scene));
+    scene.width = width;
+    scene.height = height;
+
+    return scene;
+}
+
+void GRFX_Destroy_Scene(struct GRFX_Scene *scene) {
+    // Free blocks
+    free(scene->blocks);
+    free(scene->block_ior);
+    free(scene->block_vx);
+    free(scene->block_vy);
+    GRFX_Destroy_BVH(&scene->bvh);
+    GRFX_Destroy_SDF(&scene->sdf);
+    GRFX_Close_Cache(scene);
+    GRFX_Destroy_Mask(&scene->mask);
+
+    // Free segment, circle and polygon occluders
+    free(scene->segments.x1);
+    free(scene->segments.y1);
+    free(scene->segments.x2);
+    free(scene->segments.y2);
+    free(scene->circles.x);
+    free(scene->circles.y);
+    free(scene->circles.r);
+    free(scene->polygons.first);
+    free(scene->polygons.count);
+
+    memset(scene, 0, sizeof(*scene));
+}
+
+void GRFX_Clear_Scene(struct GRFX_Scene *scene) {
+    scene->num_blocks = 0;
+    scene->segments.count = 0;
+    scene->circles.count = 0;
+    scene->polygons.num = 0;
+    GRFX_Destroy_Mask(&scene->mask);
+}
+
+struct GRFX_Scene_Mark GRFX_Mark_Scene(const struct GRFX_Scene *scene) {
+    return (struct GRFX_Scene_Mark){ scene->num_blocks, scene->segments.count, scene->circles.count, scene->polygons.num };
+}
+
+void GRFX_Reset_Scene(struct GRFX_Scene *scene, struct GRFX_Scene_Mark mark) {
+    scene->num_blocks = mark.blocks;
+    scene->segments.count = mark.segments;
+    scene->circles.count = mark.circles;
+    scene->polygons.num = mark.polygons;
+}
+
+void GRFX_Append_Scene(struct GRFX_Scene *scene, const struct GRFX_Scene *other) {
+    const struct GRFX_Segments *segs = &other->segments;
+    struct GRFX_Polygons *polys = &scene->polygons;
+    int offset = scene->segments.count;
+
+    for (int i = 0; i < other->num_blocks; i++) {
+        const SDL_FRect *box = &other->blocks[i];
+        int id = GRFX_Add_Block(scene, box->x, box->y, box->w, box->h, other->block_ior[i]);
+        GRFX_Set_Block_Velocity(scene, id, other->block_vx[i], other->block_vy[i]);
+    }
+
+    for (int i = 0; i < segs->count; i++) {
+        GRFX_Add_Segment(scene, segs->x1[i], segs->y1[i], segs->x2[i], segs->y2[i]);
+    }
+
+    for (int i = 0; i < other->circles.count; i++) {
+        GRFX_Add_Circle(scene, other->circles.x[i], other->circles.y[i], other->circles.r[i]);
+    }
+
+    // Polygon edges came along with the segments, only their ranges need moving
+    for (int i = 0; i < other->polygons.num; i++) {
+        if (polys->num == polys->capacity) {
+            polys->capacity = polys->capacity ? polys->capacity * 2 : 8;
+            polys->first = realloc(polys->first, polys->capacity * sizeof(int));
+            polys->count = realloc(polys->count, polys->capacity * sizeof(int));
+        }
+
+        polys->first[polys->num] = other->polygons.first[i] + offset;
+        polys->count[polys->num] = other->polygons.count[i];
+        polys->num++;
+    }
+}
+
+bool GRFX_Load_Scene(struct GRFX_Scene *scene, const char *path) {
+    char line[4096];
+    char item[32];
+    char mask_path[1024];
+    int line_number = 0;
+    int have_light = false;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        return SDL_SetError("Could not open scene %s", path);
+    }
+
+    GRFX_Clear_Scene(scene);
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        float v[7] = { 0 };
+        int n, used;
+        line_number++;
+
+        // Skip blank lines and comments
+        if (sscanf(line, " %31s%n", item, &used) != 1 || item[0] == '#') continue;
+
+        char *args = line + used;
+
+        if (strcmp(item, "size") == 0 && sscanf(args, "%f %f", &v[0], &v[1]) == 2) {
+            scene->width = v[0];
+            scene->height = v[1];
+        }
+        else if (strcmp(item, "light") == 0 && sscanf(args, "%f %f %f", &v[0], &v[1], &v[2]) >= 2) {
+            scene->light_x = v[0];
+            scene->light_y = v[1];
+            scene->light_r = v[2];
+            have_light = true;
+        }
+        else if (strcmp(item, "block") == 0 && sscanf(args, "%f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]) >= 4) {
+            int id = GRFX_Add_Block(scene, v[0], v[1], v[2], v[3], v[4]);
+            GRFX_Set_Block_Velocity(scene, id, v[5], v[6]);
+        }
+        else if (strcmp(item, "segment") == 0 && sscanf(args, "%f %f %f %f", &v[0], &v[1], &v[2], &v[3]) == 4) {
+            GRFX_Add_Segment(scene, v[0], v[1], v[2], v[3]);
+        }
+        else if (strcmp(item, "circle") == 0 && sscanf(args, "%f %f %f", &v[0], &v[1], &v[2]) == 3 && v[2] > 0) {
+            GRFX_Add_Circle(scene, v[0], v[1], v[2]);
+        }
+        else if (strcmp(item, "polygon") == 0 && sscanf(args, "%d%n", &n, &used) == 1 && n >= 3 && n <= 256) {
+            float points[512];
+            int i;
+
+            args += used;
+            for (i = 0; i < n * 2 && sscanf(args, "%f%n", &points[i], &used) == 1; i++) {
+                args += used;
+            }
+
+            if (i < n * 2) {
+                fclose(file);
+                return SDL_SetError("%s:%d: polygon needs %d points", path, line_number, n);
+            }
+
+            GRFX_Add_Polygon(scene, points, n);
+        }
+        else if (strcmp(item, "mask") == 0 && sscanf(args, "%1023s %f %f %f", mask_path, &v[0], &v[1], &v[2]) == 4) {
+            // Mask files sit next to the scene file
+            const char *slash = strrchr(path, '/');
+            int dir = mask_path[0] != '/' && slash != NULL ? (int)(slash - path + 1) : 0;
+            char full[2048];
+
+            SDL_snprintf(full, sizeof(full), "%.*s%s", dir, path, mask_path);
+
+            if (!GRFX_Load_Mask(scene, full, v[0], v[1], v[2])) {
+                fclose(file);
+                return SDL_SetError("%s:%d: could not load mask %s: %s", path, line_number, full, SDL_GetError());
+            }
+        }
+        else {
+            fclose(file);
+            return SDL_SetError("%s:%d: could not read '%s'", path, line_number, item);
+        }
+    }
+
+    fclose(file);
+
+    // Without a light line the light sits in the middle
+    if (!have_light) {
+        scene->light_x = scene->width / 2;
+        scene->light_y = scene->height / 2;
+        scene->light_r = 0;
+    }
+
+    return true;
+}
+
+int GRFX_Add_Block(struct GRFX_Scene *scene, float x, float y, float w, float h, float ior) {
+    if (scene->num_blocks == scene->block_capacity) {
+        scene->block_capacity = scene->block_capacity ? scene->block_capacity * 2 : 16;
+        scene->blocks = realloc(scene->blocks, scene->block_capacity * sizeof(SDL_FRect));
+        scene->block_ior = realloc(scene->block_ior, scene->block_capacity * sizeof(float));
+        scene->block_vx = realloc(scene->block_vx, scene->block_capacity * sizeof(float));
+        scene->block_vy = realloc(scene->block_vy, scene->block_capacity * sizeof(float));
+    }
+
+    scene->blocks[scene->num_blocks].x = x;
+    scene->blocks[scene->num_blocks].y = y;
+    scene->blocks[scene->num_blocks].w = w;
+    scene->blocks[scene->num_blocks].h = h;
+    scene->block_ior[scene->num_blocks] = ior;
+    scene->block_vx[scene->num_blocks] = 0;
+    scene->block_vy[scene->num_blocks] = 0;
+
+    return scene->num_blocks++;
+}
+
+void GRFX_Set_Block_Velocity(struct GRFX_Scene *scene, int id, float vx, float vy) {
+    scene->block_vx[id] = vx;
+    scene->block_vy[id] = vy;
+}
+
+void GRFX_Animate_Blocks(struct GRFX_Scene *scene, float dt) {
+    for (int i = 0; i < scene->num_blocks; i++) {
+        SDL_FRect *box = &scene->blocks[i];
+
+        if (scene->block_vx[i] == 0 && scene->block_vy[i] == 0) continue;
+
+        box->x += scene->block_vx[i] * dt;
+        box->y += scene->block_vy[i] * dt;
+
+        // Bounce off the walls
+        if ((box->x < 0 && scene->block_vx[i] < 0) || (box->x + box->w > scene->width && scene->block_vx[i] > 0)) {
+            scene->block_vx[i] = -scene->block_vx[i];
+        }
+
+        if ((box->y < 0 && scene->block_vy[i] < 0) || (box->y + box->h > scene->height && scene->block_vy[i] > 0)) {
+            scene->block_vy[i] = -scene->block_vy[i];
+        }
+    }
+}
+
+int GRFX_Add_Segment(struct GRFX_Scene *scene, float x1, float y1, float x2, float y2) {
+    struct GRFX_Segments *segs = &scene->segments;
+
+    if (segs->count == segs->capacity) {
+        segs->capacity = segs->capacity ? segs->capacity * 2 : 16;
+        segs->x1 = realloc(segs->x1, segs->capacity * sizeof(float));
+        segs->y1 = realloc(segs->y1, segs->capacity * sizeof(float));
+        segs->x2 = realloc(segs->x2, segs->capacity * sizeof(float));
+        segs->y2 = realloc(segs->y2, segs->capacity * sizeof(float));
+    }
+
+    segs->x1[segs->count] = x1;
+    segs->y1[segs->count] = y1;
+    segs->x2[segs->count] = x2;
+    segs->y2[segs->count] = y2;
+
+    return segs->count++;
+}
+
+int GRFX_Add_Polygon(struct GRFX_Scene *scene, const float *points, int n) {
+    struct GRFX_Polygons *polys = &scene->polygons;
+
+    if (n < 3) return -1;
+
+    if (polys->num == polys->capacity) {
+        polys->capacity = polys->capacity ? polys->capacity * 2 : 8;
+        polys->first = realloc(polys->first, polys->capacity * sizeof(int));
+        polys->count = realloc(polys->count, polys->capacity * sizeof(int));
+    }
+
+    polys->first[polys->num] = scene->segments.count;
+    polys->count[polys->num] = n;
+
+    // Polygon edges go into the segment arrays, closing back to the first point
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1) % n;
+        GRFX_Add_Segment(scene, points[i * 2], points[i * 2 + 1], points[j * 2], points[j * 2 + 1]);
+    }
+
+    return polys->num++;
+}
+
+int GRFX_Add_Circle(struct GRFX_Scene *scene, float x, float y, float r) {
+    struct GRFX_Circles *circles = &scene->circles;
+
+    // Normals are divided by the radius, which has to be a positive number
+    if (!(r > 0)) return -1;
+
+    if (circles->count == circles->capacity) {
+        circles->capacity = circles->capacity ? circles->capacity * 2 : 16;
+        circles->x = realloc(circles->x, circles->capacity * sizeof(float));
+        circles->y = realloc(circles->y, circles->capacity * sizeof(float));
+        circles->r = realloc(circles->r, circles->capacity * sizeof(float));
+    }
+
+    circles->x[circles->count] = x;
+    circles->y[circles->count] = y;
+    circles->r[circles->count] = r;
+
+    return circles->count++;
+}
+
+struct GRFX_Ray_Pool GRFX_Create_Ray_Pool(int capacity) {
+    struct GRFX_Ray_Pool pool;
+
+    pool.rays = malloc(capacity * sizeof(struct GRFX_Ray));
+    pool.count = 0;
+    pool.capacity = pool.rays != NULL ? capacity : 0;
+    pool.warm = false;
+    pool.hints = NULL;
+    pool.hint_rays = 0;
+
+    return pool;
+}
+
+bool GRFX_Warm_Ray_Pool(struct GRFX_Ray_Pool *pool, int max_rays) {
+    Sint32 *hints = realloc(pool->hints, (size_t)max_rays * HIT_CACHE_SLOTS * sizeof(Sint32));
+
+    if (hints == NULL) return false;
+
+    for (int i = 0; i < max_rays * HIT_CACHE_SLOTS; i++) hints[i] = -1;
+    pool->hints = hints;
+    pool->hint_rays = max_rays;
+    pool->warm = true;
+
+    return true;
+}
+
+void GRFX_Destroy_Ray_Pool(struct GRFX_Ray_Pool *pool) {
+    free(pool->rays);
+    pool->rays = NULL;
+    pool->count = 0;
+    pool->capacity = 0;
+    free(pool->hints);
+    pool->hints = NULL;
+    pool->hint_rays = 0;
+}
+
+#pragma endregion Scene Def
@@ -0,0 +1,365 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region SDF Def
+
+// Stands in for an infinite squared distance, still finite so squares can be added to it
+#define SDF_FAR 1e20f
+
+// A window of cells to transform, and the part of it whose results are kept
+struct GRFX_SDF_Job {
+    struct GRFX_SDF *sdf;
+    int x_min;
+    int y_min;
+    int x_max;
+    int y_max;
+    int out_x_min;
+    int out_y_min;
+    int out_x_max;
+    int out_y_max;
+};
+
+// Exact 1D squared distance transform (Felzenszwalb and Huttenlocher): d[q] = min over p of (q - p)^2 + f[p].
+// Walks the lower envelope of the parabolas rooted at every sample.
+static void GRFX_SDF_Transform(const float *f, int n, float *d, int *v, float *z) {
+    int k = 0;
+
+    v[0] = 0;
+    z[0] = -SDF_FAR;
+    z[1] = SDF_FAR;
+
+    for (int q = 1; q < n; q++) {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = SDF_FAR;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) k++;
+        d[q] = (float)(q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+// Bytes of scratch one thread needs for a transform along the longer side
+static size_t GRFX_SDF_Scratch_Size(const struct GRFX_SDF *sdf) {
+    int n = SDL_max(sdf->width, sdf->height);
+    return (3 * n + 1) * sizeof(float) + n * sizeof(int);
+}
+
+// Carve a thread's scratch into the transform's arrays
+static void GRFX_SDF_Scratch(const struct GRFX_SDF *sdf, int thread, float **f, float **d, float **z, int **v) {
+    int n = SDL_max(sdf->width, sdf->height);
+
+    *f = (float *)(sdf->scratch + thread * GRFX_SDF_Scratch_Size(sdf));
+    *d = *f + n;
+    *z = *d + n;
+    *v = (int *)(*z + n + 1);
+}
+
+// Worker job: squared distances along one row to the nearest covered cell, and inside covered cells to the nearest free one
+static void GRFX_SDF_Row(void *data, int index, int thread) {
+    struct GRFX_SDF_Job *job = data;
+    struct GRFX_SDF *sdf = job->sdf;
+    int n = job->x_max - job->x_min;
+    int row = (job->y_min + index) * sdf->width + job->x_min;
+    const int *start = sdf->cell_start + row;
+    float *f, *d, *z;
+    int *v;
+
+    GRFX_SDF_Scratch(sdf, thread, &f, &d, &z, &v);
+
+    for (int x = 0; x < n; x++) f[x] = start[x + 1] > start[x] ? 0 : SDF_FAR;
+    GRFX_SDF_Transform(f, n, d, v, z);
+    memcpy(sdf->row_out + row, d, n * sizeof(float));
+
+    for (int x = 0; x < n; x++) f[x] = start[x + 1] > start[x] ? SDF_FAR : 0;
+    GRFX_SDF_Transform(f, n, d, v, z);
+    memcpy(sdf->row_in + row, d, n * sizeof(float));
+}
+
+// Worker job: finish one column from the row distances, negative inside covered cells
+static void GRFX_SDF_Column(void *data, int index, int thread) {
+    struct GRFX_SDF_Job *job = data;
+    struct GRFX_SDF *sdf = job->sdf;
+    int x = job->out_x_min + index;
+    int n = job->y_max - job->y_min;
+    float *f, *d, *z;
+    int *v;
+
+    GRFX_SDF_Scratch(sdf, thread, &f, &d, &z, &v);
+
+    for (int y = 0; y < n; y++) f[y] = sdf->row_out[(job->y_min + y) * sdf->width + x];
+    GRFX_SDF_Transform(f, n, d, v, z);
+
+    for (int y = job->out_y_min; y < job->out_y_max; y++) {
+        sdf->dist[y * sdf->width + x] = fminf(sdf->cell * sqrtf(d[y - job->y_min]), SDF_MAX_DIST);
+    }
+
+    for (int y = 0; y < n; y++) f[y] = sdf->row_in[(job->y_min + y) * sdf->width + x];
+    GRFX_SDF_Transform(f, n, d, v, z);
+
+    for (int y = job->out_y_min; y < job->out_y_max; y++) {
+        int c = y * sdf->width + x;
+        if (sdf->cell_start[c + 1] > sdf->cell_start[c]) sdf->dist[c] = -fminf(sdf->cell * sqrtf(d[y - job->y_min]), SDF_MAX_DIST);
+    }
+}
+
+// First pass counts the occluders of a cell, the second one files them
+static inline void GRFX_SDF_Mark(struct GRFX_SDF *sdf, int cx, int cy, int value, int pass) {
+    int c = cy * sdf->width + cx;
+
+    if (pass == 0) {
+        sdf->cell_start[c + 1]++;
+    } else {
+        sdf->cell_items[sdf->cell_start[c]++] = value;
+    }
+}
+
+// Cover every cell a box touches, so no surface ends up in a cell that doesn't list it
+static void GRFX_SDF_Cover_Box(struct GRFX_SDF *sdf, float x1, float y1, float x2, float y2, int value, int pass) {
+    int cx_min = SDL_max((int)floorf(x1 / sdf->cell), 0);
+    int cy_min = SDL_max((int)floorf(y1 / sdf->cell), 0);
+    int cx_max = SDL_min((int)floorf(x2 / sdf->cell), sdf->width - 1);
+    int cy_max = SDL_min((int)floorf(y2 / sdf->cell), sdf->height - 1);
+
+    for (int cy = cy_min; cy <= cy_max; cy++) {
+        for (int cx = cx_min; cx <= cx_max; cx++) GRFX_SDF_Mark(sdf, cx, cy, value, pass);
+    }
+}
+
+// Cover the cells a circle overlaps
+static void GRFX_SDF_Cover_Circle(struct GRFX_SDF *sdf, float x, float y, float r, int value, int pass) {
+    int cx_min = SDL_max((int)floorf((x - r) / sdf->cell), 0);
+    int cy_min = SDL_max((int)floorf((y - r) / sdf->cell), 0);
+    int cx_max = SDL_min((int)floorf((x + r) / sdf->cell), sdf->width - 1);
+    int cy_max = SDL_min((int)floorf((y + r) / sdf->cell), sdf->height - 1);
+
+    for (int cy = cy_min; cy <= cy_max; cy++) {
+        for (int cx = cx_min; cx <= cx_max; cx++) {
+            // Closest point of the cell to the center
+            float px = SDL_clamp(x, cx * sdf->cell, (cx + 1) * sdf->cell);
+            float py = SDL_clamp(y, cy * sdf->cell, (cy + 1) * sdf->cell);
+
+            if ((px - x) * (px - x) + (py - y) * (py - y) <= r * r) GRFX_SDF_Mark(sdf, cx, cy, value, pass);
+        }
+    }
+}
+
+// Cover the cells a segment passes through, walking them in order (Amanatides and Woo)
+static void GRFX_SDF_Cover_Segment(struct GRFX_SDF *sdf, float x1, float y1, float x2, float y2, int value, int pass) {
+    float dx = x2 - x1, dy = y2 - y1;
+    int cx = (int)floorf(x1 / sdf->cell), cy = (int)floorf(y1 / sdf->cell);
+    int end_x = (int)floorf(x2 / sdf->cell), end_y = (int)floorf(y2 / sdf->cell);
+    int step_x = dx > 0 ? 1 : -1, step_y = dy > 0 ? 1 : -1;
+    int n = abs(end_x - cx) + abs(end_y - cy);
+    float t_x = dx > 0 ? ((cx + 1) * sdf->cell - x1) / dx : dx < 0 ? (cx * sdf->cell - x1) / dx : INFINITY;
+    float t_y = dy > 0 ? ((cy + 1) * sdf->cell - y1) / dy : dy < 0 ? (cy * sdf->cell - y1) / dy : INFINITY;
+    float t_dx = dx != 0 ? sdf->cell / fabsf(dx) : INFINITY;
+    float t_dy = dy != 0 ? sdf->cell / fabsf(dy) : INFINITY;
+
+    for (int k = 0; k <= n; k++) {
+        if (cx >= 0 && cx < sdf->width && cy >= 0 && cy < sdf->height) GRFX_SDF_Mark(sdf, cx, cy, value, pass);
+
+        if (t_x < t_y) {
+            t_x += t_dx;
+            cx += step_x;
+        } else {
+            t_y += t_dy;
+            cy += step_y;
+        }
+    }
+}
+
+// Cover the cells whose centers are inside a polygon, by counting edge crossings to the right.
+// The edges cover the cells along the outline.
+static void GRFX_SDF_Cover_Polygon(struct GRFX_SDF *sdf, const struct GRFX_Segments *segs, int first, int count, int pass) {
+    float x_min = INFINITY, y_min = INFINITY, x_max = -INFINITY, y_max = -INFINITY;
+
+    for (int i = first; i < first + count; i++) {
+        x_min = fminf(x_min, segs->x1[i]), x_max = fmaxf(x_max, segs->x1[i]);
+        y_min = fminf(y_min, segs->y1[i]), y_max = fmaxf(y_max, segs->y1[i]);
+    }
+
+    int cx_min = SDL_max((int)floorf(x_min / sdf->cell), 0);
+    int cy_min = SDL_max((int)floorf(y_min / sdf->cell), 0);
+    int cx_max = SDL_min((int)floorf(x_max / sdf->cell), sdf->width - 1);
+    int cy_max = SDL_min((int)floorf(y_max / sdf->cell), sdf->height - 1);
+
+    for (int cy = cy_min; cy <= cy_max; cy++) {
+        float py = (cy + 0.5f) * sdf->cell;
+
+        for (int cx = cx_min; cx <= cx_max; cx++) {
+            float px = (cx + 0.5f) * sdf->cell;
+            bool inside = false;
+
+            for (int i = first; i < first + count; i++) {
+                float ax = segs->x1[i], ay = segs->y1[i], bx = segs->x2[i], by = segs->y2[i];
+                if ((ay > py) != (by > py) && px < ax + (py - ay) * (bx - ax) / (by - ay)) inside = !inside;
+            }
+
+            if (inside) GRFX_SDF_Mark(sdf, cx, cy, GRFX_HIT_SEGMENT << SDF_KIND_SHIFT | first, pass);
+        }
+    }
+}
+
+// Sort the occluders into the cells they touch, keeping the lists packed like the rasterizer's tile bins
+static void GRFX_SDF_Cover(struct GRFX_SDF *sdf, const struct GRFX_Scene *scene) {
+    const struct GRFX_Segments *segs = &scene->segments;
+    const struct GRFX_Mask *mask = &scene->mask;
+    int cells = sdf->width * sdf->height;
+
+    memset(sdf->cell_start, 0, (cells + 1) * sizeof(int));
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < scene->num_blocks; i++) {
+            const SDL_FRect *box = &scene->blocks[i];
+            GRFX_SDF_Cover_Box(sdf, box->x, box->y, box->x + box->w, box->y + box->h, GRFX_HIT_BLOCK << SDF_KIND_SHIFT | i, pass);
+        }
+
+        for (int i = 0; i < scene->circles.count; i++) {
+            GRFX_SDF_Cover_Circle(sdf, scene->circles.x[i], scene->circles.y[i], scene->circles.r[i], GRFX_HIT_CIRCLE << SDF_KIND_SHIFT | i, pass);
+        }
+
+        for (int i = 0; i < scene->polygons.num; i++) {
+            GRFX_SDF_Cover_Polygon(sdf, segs, scene->polygons.first[i], scene->polygons.count[i], pass);
+        }
+
+        for (int i = 0; i < segs->count; i++) {
+            GRFX_SDF_Cover_Segment(sdf, segs->x1[i], segs->y1[i], segs->x2[i], segs->y2[i], GRFX_HIT_SEGMENT << SDF_KIND_SHIFT | i, pass);
+        }
+
+        // Every set mask cell is filed like a tiny block
+        for (int cy = 0; mask->bits != NULL && cy < mask->height; cy++) {
+            for (int cx = 0; cx < mask->width; cx++) {
+                if (!((mask->bits[cy * mask->pitch + (cx >> 6)] >> (cx & 63)) & 1)) continue;
+
+                float x = mask->x + cx * mask->cell, y = mask->y + cy * mask->cell;
+                GRFX_SDF_Cover_Box(sdf, x, y, x + mask->cell, y + mask->cell, GRFX_HIT_MASK << SDF_KIND_SHIFT | (cy * mask->width + cx), pass);
+            }
+        }
+
+        if (pass == 1) break;
+
+        for (int c = 0; c < cells; c++) sdf->cell_start[c + 1] += sdf->cell_start[c];
+
+        if (sdf->cell_start[cells] > sdf->item_capacity) {
+            sdf->item_capacity = sdf->cell_start[cells] * 2;
+            sdf->cell_items = realloc(sdf->cell_items, sdf->item_capacity * sizeof(int));
+        }
+    }
+
+    // Filling used the starts as cursors, shift them back into place
+    for (int c = cells; c > 0; c--) sdf->cell_start[c] = sdf->cell_start[c - 1];
+    sdf->cell_start[0] = 0;
+}
+
+void GRFX_Build_SDF(struct GRFX_Scene *scene, float cell, struct GRFX_Workers *workers) {
+    struct GRFX_SDF *sdf = &scene->sdf;
+    int width = (int)ceilf(scene->width / cell), height = (int)ceilf(scene->height / cell);
+    size_t cells = (size_t)width * height;
+
+    if (width != sdf->width || height != sdf->height) {
+        GRFX_Destroy_SDF(sdf);
+        sdf->width = width;
+        sdf->height = height;
+        sdf->dist = malloc(cells * sizeof(float));
+        sdf->cell_start = malloc((cells + 1) * sizeof(int));
+        sdf->row_out = malloc(cells * sizeof(float));
+        sdf->row_in = malloc(cells * sizeof(float));
+    }
+
+    sdf->cell = cell;
+    GRFX_Invalidate_SDF(scene, NULL);
+    GRFX_Update_SDF(scene, workers);
+}
+
+void GRFX_Invalidate_SDF(struct GRFX_Scene *scene, const SDL_FRect *region) {
+    struct GRFX_SDF *sdf = &scene->sdf;
+
+    if (region == NULL) {
+        sdf->dirty_all = true;
+    } else if (!sdf->has_dirty) {
+        sdf->dirty = *region;
+    } else {
+        SDL_GetRectUnionFloat(&sdf->dirty, region, &sdf->dirty);
+    }
+
+    sdf->has_dirty = true;
+}
+
+void GRFX_Update_SDF(struct GRFX_Scene *scene, struct GRFX_Workers *workers) {
+    struct GRFX_SDF *sdf = &scene->sdf;
+    struct GRFX_SDF_Job job = { sdf, 0, 0, sdf->width, sdf->height, 0, 0, sdf->width, sdf->height };
+    int threads = workers != NULL ? workers->num_threads : 1;
+
+    if (sdf->dist == NULL || !sdf->has_dirty) return;
+
+    // Outside the dirty window the mapped distances stay valid, so they come along
+    if (sdf->mapped) {
+        size_t cells = (size_t)sdf->width * sdf->height;
+        float *dist = malloc(cells * sizeof(float));
+
+        memcpy(dist, sdf->dist, cells * sizeof(float));
+        sdf->dist = dist;
+        sdf->cell_start = malloc((cells + 1) * sizeof(int));
+        sdf->cell_items = NULL;
+        sdf->item_capacity = 0;
+        sdf->mapped = false;
+    }
+
+    if (threads > sdf->scratch_threads) {
+        sdf->scratch_threads = threads;
+        sdf->scratch = realloc(sdf->scratch, threads * GRFX_SDF_Scratch_Size(sdf));
+    }
+
+    // Re-filing every occluder is cheap next to the transform
+    GRFX_SDF_Cover(sdf, scene);
+
+    if (!sdf->dirty_all) {
+        // Clamped distances only change within SDF_MAX_DIST of the edit, and those need the
+        // cells up to SDF_MAX_DIST further out to come out exact
+        int reach = (int)ceilf(SDF_MAX_DIST / sdf->cell) + 1;
+        int cx_min = (int)floorf(sdf->dirty.x / sdf->cell), cy_min = (int)floorf(sdf->dirty.y / sdf->cell);
+        int cx_max = (int)floorf((sdf->dirty.x + sdf->dirty.w) / sdf->cell) + 1;
+        int cy_max = (int)floorf((sdf->dirty.y + sdf->dirty.h) / sdf->cell) + 1;
+
+        job.out_x_min = SDL_max(cx_min - reach, 0), job.out_x_max = SDL_min(cx_max + reach, sdf->width);
+        job.out_y_min = SDL_max(cy_min - reach, 0), job.out_y_max = SDL_min(cy_max + reach, sdf->height);
+        job.x_min = SDL_max(cx_min - 2 * reach, 0), job.x_max = SDL_min(cx_max + 2 * reach, sdf->width);
+        job.y_min = SDL_max(cy_min - 2 * reach, 0), job.y_max = SDL_min(cy_max + 2 * reach, sdf->height);
+    }
+
+    if (job.out_x_min < job.out_x_max && job.out_y_min < job.out_y_max) {
+        GRFX_Parallel_For(workers, job.y_max - job.y_min, GRFX_SDF_Row, &job);
+        GRFX_Parallel_For(workers, job.out_x_max - job.out_x_min, GRFX_SDF_Column, &job);
+    }
+
+    sdf->dirty_all = false;
+    sdf->has_dirty = false;
+}
+
+void GRFX_Destroy_SDF(struct GRFX_SDF *sdf) {
+    if (!sdf->mapped) {
+        free(sdf->dist);
+        free(sdf->cell_start);
+        free(sdf->cell_items);
+    }
+    free(sdf->row_out);
+    free(sdf->row_in);
+    free(sdf->scratch);
+    memset(sdf, 0, sizeof(*sdf));
+}
+
+#pragma endregion SDF Def
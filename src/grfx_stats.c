@@ -0,0 +1,172 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Stats Def
+
+struct GRFX_Stats_State grfx_stats_state;
+
+static struct GRFX_Stats grfx_main_stats;
+
+_Thread_local struct GRFX_Stats *grfx_stats = &grfx_main_stats;
+
+void GRFX_Stats_Init() {
+    memset(&grfx_stats_state, 0, sizeof(grfx_stats_state));
+    grfx_stats_state.history = malloc(STATS_HISTORY * sizeof(struct GRFX_Stats));
+    GRFX_Stats_Register_Thread(&grfx_main_stats);
+    grfx_stats_state.last_allocations = GRFX_Alloc_Count();
+}
+
+void GRFX_Stats_Register_Thread(struct GRFX_Stats *stats) {
+    GRFX_Stats_Track(stats);
+    grfx_stats = stats;
+}
+
+void GRFX_Stats_Track(struct GRFX_Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    if (grfx_stats_state.num_threads < STATS_MAX_THREADS) {
+        grfx_stats_state.threads[grfx_stats_state.num_threads++] = stats;
+    }
+}
+
+void GRFX_Stats_Untrack(struct GRFX_Stats *stats) {
+    for (int t = 0; t < grfx_stats_state.num_threads; t++) {
+        if (grfx_stats_state.threads[t] == stats) {
+            grfx_stats_state.threads[t] = grfx_stats_state.threads[--grfx_stats_state.num_threads];
+            return;
+        }
+    }
+}
+
+void GRFX_Stats_Frame_End(Uint64 frame_ns) {
+    struct GRFX_Stats *frame = &grfx_stats_state.frame;
+
+    // Sum and reset the per-thread counters
+    memset(frame, 0, sizeof(*frame));
+    for (int t = 0; t < grfx_stats_state.num_threads; t++) {
+        Uint64 *src = (Uint64 *)grfx_stats_state.threads[t];
+        Uint64 *dst = (Uint64 *)frame;
+        for (size_t i = 0; i < sizeof(struct GRFX_Stats) / sizeof(Uint64); i++) {
+            dst[i] += src[i];
+        }
+        memset(grfx_stats_state.threads[t], 0, sizeof(struct GRFX_Stats));
+    }
+    frame->frame_ns = frame_ns;
+
+    // Allocations are counted process wide rather than per thread
+    Uint32 allocations = GRFX_Alloc_Count();
+    frame->allocations = (Uint32)(allocations - grfx_stats_state.last_allocations);
+    grfx_stats_state.last_allocations = allocations;
+
+    Uint64 *src = (Uint64 *)frame;
+    Uint64 *dst = (Uint64 *)&grfx_stats_state.total;
+    for (size_t i = 0; i < sizeof(struct GRFX_Stats) / sizeof(Uint64); i++) {
+        dst[i] += src[i];
+    }
+
+    if (grfx_stats_state.history != NULL) {
+        grfx_stats_state.history[grfx_stats_state.frames % STATS_HISTORY] = *frame;
+    }
+    grfx_stats_state.frames++;
+}
+
+void GRFX_Stats_Dump(const char *path) {
+    struct GRFX_Stats *total = &grfx_stats_state.total;
+    Uint64 frames = grfx_stats_state.frames;
+    size_t len = strlen(path);
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        printf("Stats Error: could not open %s\n", path);
+        return;
+    }
+
+    // JSON gets totals and per-frame means, anything else gets a CSV row per recorded frame
+    if (len >= 5 && strcmp(path + len - 5, ".json") == 0) {
+        double n = frames > 0 ? (double)frames : 1;
+
+        fprintf(file, "{\n  \"frames\": %llu,\n", (unsigned long long)frames);
+        fprintf(file, "  \"total\": {\n");
+#define STATS_FIELD(name, last) fprintf(file, "    \"%s\": %llu%s\n", #name, (unsigned long long)total->name, last ? "" : ",")
+        STATS_FIELD(frame_ns, 0);
+        STATS_FIELD(rays, 0);
+        STATS_FIELD(bounces, 0);
+        STATS_FIELD(slab_tests, 0);
+        STATS_FIELD(node_tests, 0);
+        STATS_FIELD(segment_tests, 0);
+        STATS_FIELD(circle_tests, 0);
+        STATS_FIELD(block_hits, 0);
+        STATS_FIELD(segment_hits, 0);
+        STATS_FIELD(circle_hits, 0);
+        STATS_FIELD(wall_hits, 0);
+        STATS_FIELD(segments, 0);
+        STATS_FIELD(draw_calls, 0);
+        STATS_FIELD(bytes_uploaded, 0);
+        STATS_FIELD(culled, 0);
+        STATS_FIELD(allocations, 0);
+        STATS_FIELD(bvh_refits, 0);
+        STATS_FIELD(bvh_rebuilds, 0);
+        STATS_FIELD(sdf_steps, 0);
+        STATS_FIELD(mask_steps, 0);
+        STATS_FIELD(gi_steps, 0);
+        STATS_FIELD(power_level, 0);
+        STATS_FIELD(power_changes, 1);
+#undef STATS_FIELD
+        fprintf(file, "  },\n  \"per_frame\": {\n");
+#define STATS_FIELD(name, last) fprintf(file, "    \"%s\": %.3f%s\n", #name, total->name / n, last ? "" : ",")
+        STATS_FIELD(frame_ns, 0);
+        STATS_FIELD(rays, 0);
+        STATS_FIELD(bounces, 0);
+        STATS_FIELD(slab_tests, 0);
+        STATS_FIELD(node_tests, 0);
+        STATS_FIELD(segment_tests, 0);
+        STATS_FIELD(circle_tests, 0);
+        STATS_FIELD(block_hits, 0);
+        STATS_FIELD(segment_hits, 0);
+        STATS_FIELD(circle_hits, 0);
+        STATS_FIELD(wall_hits, 0);
+        STATS_FIELD(segments, 0);
+        STATS_FIELD(draw_calls, 0);
+        STATS_FIELD(bytes_uploaded, 0);
+        STATS_FIELD(culled, 0);
+        STATS_FIELD(allocations, 0);
+        STATS_FIELD(bvh_refits, 0);
+        STATS_FIELD(bvh_rebuilds, 0);
+        STATS_FIELD(sdf_steps, 0);
+        STATS_FIELD(mask_steps, 0);
+        STATS_FIELD(gi_steps, 0);
+        STATS_FIELD(power_level, 0);
+        STATS_FIELD(power_changes, 1);
+#undef STATS_FIELD
+        fprintf(file, "  },\n  \"hits_per_block\": [");
+        for (int i = 0; i < STATS_MAX_BLOCKS; i++) {
+            fprintf(file, "%s%llu", i ? ", " : "", (unsigned long long)total->hits_per_block[i]);
+        }
+        fprintf(file, "]\n}\n");
+    } else {
+        Uint64 first = frames > STATS_HISTORY ? frames - STATS_HISTORY : 0;
+
+        fprintf(file, "frame,frame_ns,rays,bounces,slab_tests,node_tests,segment_tests,circle_tests,block_hits,segment_hits,circle_hits,wall_hits,segments,draw_calls,bytes_uploaded,culled,allocations,bvh_refits,bvh_rebuilds,sdf_steps,mask_steps,gi_steps,power_level,power_changes\n");
+        for (Uint64 f = first; f < frames && grfx_stats_state.history != NULL; f++) {
+            struct GRFX_Stats *s = &grfx_stats_state.history[f % STATS_HISTORY];
+            fprintf(file, "%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+                (unsigned long long)f, (unsigned long long)s->frame_ns, (unsigned long long)s->rays, (unsigned long long)s->bounces,
+                (unsigned long long)s->slab_tests, (unsigned long long)s->node_tests, (unsigned long long)s->segment_tests, (unsigned long long)s->circle_tests,
+                (unsigned long long)s->block_hits, (unsigned long long)s->segment_hits, (unsigned long long)s->circle_hits,
+                (unsigned long long)s->wall_hits, (unsigned long long)s->segments, (unsigned long long)s->draw_calls,
+                (unsigned long long)s->bytes_uploaded, (unsigned long long)s->culled, (unsigned long long)s->allocations, (unsigned long long)s->bvh_refits, (unsigned long long)s->bvh_rebuilds, (unsigned long long)s->sdf_steps, (unsigned long long)s->mask_steps, (unsigned long long)s->gi_steps, (unsigned long long)s->power_level, (unsigned long long)s->power_changes);
+        }
+    }
+
+    fclose(file);
+}
+
+void GRFX_Stats_End() {
+    free(grfx_stats_state.history);
+    grfx_stats_state.history = NULL;
+}
+
+#pragma endregion Stats Def
@@ -0,0 +1,1104 @@
+#pragma region Include
+
+#include "grfx.h"
+#include <SDL3/SDL_intrin.h>
+
+#pragma endregion Include
+
+#pragma region Trace Def
+
+// Slab test of one block, updates the hit when the block is closer
+static inline void GRFX_Hit_Block(const SDL_FRect *box, int id, float x1, float y1, float dx, float dy, struct GRFX_Hit *hit) {
+    float temp, t_near, t_far;
+    float x_min, x_max, y_min, y_max;
+    float t_x1, t_y1, t_x2, t_y2;
+
+    x_min = box->x, x_max = box->x + box->w, y_min = box->y, y_max = box->y + box->h;
+    t_x1 = (x_min - x1) / dx;
+    t_x2 = (x_max - x1) / dx;
+    t_y1 = (y_min - y1) / dy;
+    t_y2 = (y_max - y1) / dy;
+
+    if (t_x1 > t_x2) {
+        temp = t_x1; t_x1 = t_x2; t_x2 = temp;
+    }
+
+    if (t_y1 > t_y2) {
+        temp = t_y1; t_y1 = t_y2; t_y2 = temp;
+    }
+
+    t_near = fmaxf(t_x1, t_y1);
+    t_far = fminf(t_x2, t_y2);
+
+    if (t_near <= t_far && t_far >= 0 && t_near < hit->t) {
+        hit->kind = GRFX_HIT_BLOCK;
+        hit->id = id;
+        hit->t = t_near;
+
+        // The slab that was entered last is the side that got hit
+        if (t_x1 > t_y1) {
+            hit->nx = dx > 0 ? -1 : 1;
+            hit->ny = 0;
+        } else {
+            hit->nx = 0;
+            hit->ny = dy > 0 ? -1 : 1;
+        }
+    }
+}
+
+// Slab tests of a block count fixed at compile time, unrolled so small scenes pay no loop overhead
+#define GRFX_HIT_BLOCKS_FIXED(n) \
+    static void GRFX_Hit_Blocks_##n(const SDL_FRect *blocks, float x1, float y1, float dx, float dy, int skip, struct GRFX_Hit *hit) { \
+        _Pragma("GCC unroll 8") \
+        for (int i = 0; i < n; i++) { \
+            if (i != skip) GRFX_Hit_Block(&blocks[i], i, x1, y1, dx, dy, hit); \
+        } \
+    }
+
+GRFX_HIT_BLOCKS_FIXED(1)
+GRFX_HIT_BLOCKS_FIXED(2)
+GRFX_HIT_BLOCKS_FIXED(3)
+GRFX_HIT_BLOCKS_FIXED(4)
+GRFX_HIT_BLOCKS_FIXED(5)
+GRFX_HIT_BLOCKS_FIXED(6)
+GRFX_HIT_BLOCKS_FIXED(7)
+GRFX_HIT_BLOCKS_FIXED(8)
+
+SDL_COMPILE_TIME_ASSERT(fixed_max_blocks, FIXED_MAX_BLOCKS == 8);
+
+static void (*const grfx_hit_blocks_fixed[FIXED_MAX_BLOCKS + 1])(const SDL_FRect *, float, float, float, float, int, struct GRFX_Hit *) = {
+    NULL, GRFX_Hit_Blocks_1, GRFX_Hit_Blocks_2, GRFX_Hit_Blocks_3, GRFX_Hit_Blocks_4, GRFX_Hit_Blocks_5, GRFX_Hit_Blocks_6, GRFX_Hit_Blocks_7, GRFX_Hit_Blocks_8
+};
+
+// Walk the block BVH nearest child first, skipping nodes behind the closest hit so far
+static void GRFX_Hit_Blocks_BVH(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, int skip, struct GRFX_Hit *hit) {
+    const struct GRFX_BVH *bvh = &scene->bvh;
+    float t_enter[2];
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+    int nodes = 0, slabs = 0;
+
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const struct GRFX_BVH_Node *node = &bvh->nodes[stack[--top]];
+
+        if (node->count > 0) {
+            for (int i = node->first; i < node->first + node->count; i++) {
+                int id = bvh->indices[i];
+                if (id == skip) continue;
+                GRFX_Hit_Block(&scene->blocks[id], id, x1, y1, dx, dy, hit);
+            }
+            slabs += node->count;
+            continue;
+        }
+
+        // Test both children, push the far one first so the near one is walked first
+        for (int c = 0; c < 2; c++) {
+            const struct GRFX_BVH_Node *child = &bvh->nodes[node->first + c];
+            float t_x1 = (child->x_min - x1) / dx, t_x2 = (child->x_max - x1) / dx;
+            float t_y1 = (child->y_min - y1) / dy, t_y2 = (child->y_max - y1) / dy;
+            float temp;
+
+            // Same slab order as the block test, so grazing rays agree with it
+            if (t_x1 > t_x2) {
+                temp = t_x1; t_x1 = t_x2; t_x2 = temp;
+            }
+
+            if (t_y1 > t_y2) {
+                temp = t_y1; t_y1 = t_y2; t_y2 = temp;
+            }
+
+            float t_near = fmaxf(t_x1, t_y1);
+            float t_far = fminf(t_x2, t_y2);
+
+            t_enter[c] = t_near <= t_far && t_far >= 0 && t_near < hit->t ? t_near : INFINITY;
+        }
+        nodes += 2;
+
+        int near = t_enter[1] < t_enter[0];
+        if (t_enter[!near] < INFINITY) stack[top++] = node->first + !near;
+        if (t_enter[near] < INFINITY) stack[top++] = node->first + near;
+    }
+
+    GRFX_STAT_ADD(node_tests, nodes);
+    GRFX_STAT_ADD(slab_tests, slabs);
+}
+
+// Record a segment hit at t, with the normal facing the ray since segments are two sided
+static void GRFX_Hit_Segment(const struct GRFX_Scene *scene, int i, float t, float dx, float dy, struct GRFX_Hit *hit) {
+    const struct GRFX_Segments *segs = &scene->segments;
+    float ex = segs->x2[i] - segs->x1[i], ey = segs->y2[i] - segs->y1[i];
+    float len = sqrtf(ex * ex + ey * ey);
+
+    hit->kind = GRFX_HIT_SEGMENT;
+    hit->id = i;
+    hit->t = t;
+    hit->nx = -ey / len;
+    hit->ny = ex / len;
+
+    if (hit->nx * dx + hit->ny * dy > 0) {
+        hit->nx = -hit->nx;
+        hit->ny = -hit->ny;
+    }
+}
+
+// Record a circle hit at t
+static void GRFX_Hit_Circle(const struct GRFX_Scene *scene, int i, float t, float x1, float y1, float dx, float dy, struct GRFX_Hit *hit) {
+    hit->kind = GRFX_HIT_CIRCLE;
+    hit->id = i;
+    hit->t = t;
+    hit->nx = (x1 + t * dx - scene->circles.x[i]) / scene->circles.r[i];
+    hit->ny = (y1 + t * dy - scene->circles.y[i]) / scene->circles.r[i];
+}
+
+// Exact test against one occluder filed in the distance field, packed as kind << SDF_KIND_SHIFT | id
+static void GRFX_Hit_Occluder(const struct GRFX_Scene *scene, int occluder, float x1, float y1, float dx, float dy, int prev_kind, int prev_id, struct GRFX_Hit *hit) {
+    int kind = occluder >> SDF_KIND_SHIFT, id = occluder & ((1 << SDF_KIND_SHIFT) - 1);
+    float t;
+
+    if (kind == prev_kind && id == prev_id) return;
+
+    if (kind == GRFX_HIT_BLOCK) {
+        GRFX_Hit_Block(&scene->blocks[id], id, x1, y1, dx, dy, hit);
+        GRFX_STAT_ADD(slab_tests, 1);
+    }
+
+    // The batch kernels take a view of just this one
+    if (kind == GRFX_HIT_SEGMENT) {
+        const struct GRFX_Segments *segs = &scene->segments;
+        struct GRFX_Segments one = { segs->x1 + id, segs->y1 + id, segs->x2 + id, segs->y2 + id, 1, 1 };
+
+        if (MAF_Ray_Segments(&one, x1, y1, dx, dy, -1, &t) == 0 && t < hit->t) GRFX_Hit_Segment(scene, id, t, dx, dy, hit);
+        GRFX_STAT_ADD(segment_tests, 1);
+    }
+
+    if (kind == GRFX_HIT_CIRCLE) {
+        const struct GRFX_Circles *circles = &scene->circles;
+        struct GRFX_Circles one = { circles->x + id, circles->y + id, circles->r + id, 1, 1 };
+
+        if (MAF_Ray_Circles(&one, x1, y1, dx, dy, -1, &t) == 0 && t < hit->t) GRFX_Hit_Circle(scene, id, t, x1, y1, dx, dy, hit);
+        GRFX_STAT_ADD(circle_tests, 1);
+    }
+
+    // A mask cell is a block one cell wide. Like in the mask walk, rays pass through the cell they start in
+    // and never hit cells behind them.
+    if (kind == GRFX_HIT_MASK) {
+        const struct GRFX_Mask *mask = &scene->mask;
+        int cx = id % mask->width, cy = id / mask->width;
+        SDL_FRect box = { mask->x + cx * mask->cell, mask->y + cy * mask->cell, mask->cell, mask->cell };
+        struct GRFX_Hit cell = *hit;
+
+        if ((int)floorf((x1 - mask->x) / mask->cell) == cx && (int)floorf((y1 - mask->y) / mask->cell) == cy) return;
+
+        GRFX_Hit_Block(&box, id, x1, y1, dx, dy, &cell);
+        if (cell.t < hit->t && cell.t >= 0) {
+            *hit = cell;
+            hit->kind = GRFX_HIT_MASK;
+        }
+        GRFX_STAT_ADD(slab_tests, 1);
+    }
+}
+
+// Sphere trace through the distance field. Away from everything the ray skips ahead by the distance,
+// near a surface it walks cell by cell and tests the occluders filed under every cell it crosses.
+static void GRFX_Hit_SDF(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, int prev_kind, int prev_id, struct GRFX_Hit *hit) {
+    const struct GRFX_SDF *sdf = &scene->sdf;
+    int step_x = dx > 0 ? 1 : -1, step_y = dy > 0 ? 1 : -1;
+    int cx = SDL_clamp((int)floorf(x1 / sdf->cell), 0, sdf->width - 1);
+    int cy = SDL_clamp((int)floorf(y1 / sdf->cell), 0, sdf->height - 1);
+
+    // Cell centers can be half a diagonal away from both the ray and the surface
+    float margin = 1.5f * sdf->cell;
+    float t = 0;
+    int tested[4] = { -1, -1, -1, -1 };
+    int steps = 0, num_tested = 0;
+
+    while (cx >= 0 && cx < sdf->width && cy >= 0 && cy < sdf->height && t < hit->t && steps < SDF_MAX_STEPS) {
+        int c = cy * sdf->width + cx;
+        float skip = sdf->dist[c] - margin;
+
+        steps++;
+
+        if (skip >= sdf->cell) {
+            t += skip;
+            cx = (int)floorf((x1 + t * dx) / sdf->cell);
+            cy = (int)floorf((y1 + t * dy) / sdf->cell);
+            continue;
+        }
+
+        // An occluder spans several cells, don't test it again right away
+        for (int i = sdf->cell_start[c]; i < sdf->cell_start[c + 1]; i++) {
+            int occluder = sdf->cell_items[i];
+
+            if (occluder == tested[0] || occluder == tested[1] || occluder == tested[2] || occluder == tested[3]) continue;
+            tested[num_tested++ & 3] = occluder;
+
+            GRFX_Hit_Occluder(scene, occluder, x1, y1, dx, dy, prev_kind, prev_id, hit);
+        }
+
+        // Step into whichever neighbour the ray leaves this cell for (Amanatides and Woo)
+        float t_x = dx > 0 ? ((cx + 1) * sdf->cell - x1) / dx : dx < 0 ? (cx * sdf->cell - x1) / dx : INFINITY;
+        float t_y = dy > 0 ? ((cy + 1) * sdf->cell - y1) / dy : dy < 0 ? (cy * sdf->cell - y1) / dy : INFINITY;
+
+        if (t_x < t_y) {
+            t = t_x;
+            cx += step_x;
+        } else {
+            t = t_y;
+            cy += step_y;
+        }
+    }
+
+    GRFX_STAT_ADD(sdf_steps, steps);
+}
+
+// Test every block, through the BVH when the scene has one, then every segment and circle.
+// hint is a block the ray probably hits, or -1.
+static void GRFX_Hit_All(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, int prev_kind, int prev_id, int hint, struct GRFX_Hit *hit) {
+    float t;
+    int i;
+
+    if (scene->num_blocks >= BVH_MIN_BLOCKS && scene->bvh.num_blocks == scene->num_blocks) {
+        int skip = prev_kind == GRFX_HIT_BLOCK ? prev_id : -1;
+
+        // The hinted block's distance bounds the walk. The bound sits just past it, so the walk finds it
+        // again and a block at the same distance wins exactly when it would have without the hint.
+        if (hint >= 0 && hint < scene->num_blocks && hint != skip) {
+            struct GRFX_Hit warm = { .kind = GRFX_HIT_NONE, .id = -1, .t = INFINITY };
+
+            GRFX_Hit_Block(&scene->blocks[hint], hint, x1, y1, dx, dy, &warm);
+            if (warm.kind == GRFX_HIT_BLOCK) hit->t = nextafterf(warm.t, INFINITY);
+            GRFX_STAT_ADD(slab_tests, 1);
+        }
+
+        GRFX_Hit_Blocks_BVH(scene, x1, y1, dx, dy, skip, hit);
+        if (hit->kind == GRFX_HIT_NONE) hit->t = INFINITY;
+    } else if (scene->num_blocks > 0 && scene->num_blocks <= FIXED_MAX_BLOCKS) {
+        grfx_hit_blocks_fixed[scene->num_blocks](scene->blocks, x1, y1, dx, dy, prev_kind == GRFX_HIT_BLOCK ? prev_id : -1, hit);
+        GRFX_STAT_ADD(slab_tests, scene->num_blocks);
+    } else {
+        for (i = 0; i < scene->num_blocks; i++) {
+            if (prev_kind == GRFX_HIT_BLOCK && i == prev_id) continue;
+            GRFX_Hit_Block(&scene->blocks[i], i, x1, y1, dx, dy, hit);
+        }
+
+        GRFX_STAT_ADD(slab_tests, scene->num_blocks);
+    }
+
+    GRFX_STAT_ADD(segment_tests, scene->segments.count);
+    GRFX_STAT_ADD(circle_tests, scene->circles.count);
+
+    // Check for segment and polygon edge collisions
+    i = MAF_Ray_Segments(&scene->segments, x1, y1, dx, dy, prev_kind == GRFX_HIT_SEGMENT ? prev_id : -1, &t);
+    if (i >= 0 && t < hit->t) GRFX_Hit_Segment(scene, i, t, dx, dy, hit);
+
+    // Check for circle collisions
+    i = MAF_Ray_Circles(&scene->circles, x1, y1, dx, dy, prev_kind == GRFX_HIT_CIRCLE ? prev_id : -1, &t);
+    if (i >= 0 && t < hit->t) GRFX_Hit_Circle(scene, i, t, x1, y1, dx, dy, hit);
+}
+
+// Walk the mask's cells along the ray (Amanatides and Woo) up to the closest hit so far. A set cell is hit
+// on the face the ray crossed into it by, which gives the normal. A ray that starts in set cells, like one
+// leaving the mask's surface, passes through them until it reaches a free cell.
+static void GRFX_Hit_Mask(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, struct GRFX_Hit *hit) {
+    const struct GRFX_Mask *mask = &scene->mask;
+    float x_max = mask->x + mask->width * mask->cell, y_max = mask->y + mask->height * mask->cell;
+    float t_enter_x = -INFINITY, t_enter_y = -INFINITY;
+    float t_exit = hit->t;
+
+    // Clip the ray to the mask's box
+    if (dx != 0) {
+        float a = (mask->x - x1) / dx, b = (x_max - x1) / dx;
+        t_enter_x = fminf(a, b);
+        t_exit = fminf(t_exit, fmaxf(a, b));
+    } else if (x1 < mask->x || x1 >= x_max) {
+        return;
+    }
+
+    if (dy != 0) {
+        float a = (mask->y - y1) / dy, b = (y_max - y1) / dy;
+        t_enter_y = fminf(a, b);
+        t_exit = fminf(t_exit, fmaxf(a, b));
+    } else if (y1 < mask->y || y1 >= y_max) {
+        return;
+    }
+
+    float t = fmaxf(fmaxf(t_enter_x, t_enter_y), 0);
+    if (t >= t_exit) return;
+
+    int step_x = dx > 0 ? 1 : -1, step_y = dy > 0 ? 1 : -1;
+    int cx = SDL_clamp((int)floorf((x1 + t * dx - mask->x) / mask->cell), 0, mask->width - 1);
+    int cy = SDL_clamp((int)floorf((y1 + t * dy - mask->y) / mask->cell), 0, mask->height - 1);
+    float t_x = dx > 0 ? (mask->x + (cx + 1) * mask->cell - x1) / dx : dx < 0 ? (mask->x + cx * mask->cell - x1) / dx : INFINITY;
+    float t_y = dy > 0 ? (mask->y + (cy + 1) * mask->cell - y1) / dy : dy < 0 ? (mask->y + cy * mask->cell - y1) / dy : INFINITY;
+    float t_dx = dx != 0 ? mask->cell / fabsf(dx) : INFINITY;
+    float t_dy = dy != 0 ? mask->cell / fabsf(dy) : INFINITY;
+
+    // Coming from outside, the first cell is entered through the box's face
+    bool leaving = t <= 0;
+    int nx = t_enter_x >= t_enter_y ? -step_x : 0, ny = t_enter_x >= t_enter_y ? 0 : -step_y;
+    int steps = 0;
+
+    for (;;) {
+        bool set = (mask->bits[cy * mask->pitch + (cx >> 6)] >> (cx & 63)) & 1;
+        steps++;
+
+        if (set && !leaving) {
+            hit->kind = GRFX_HIT_MASK;
+            hit->id = cy * mask->width + cx;
+            hit->t = t;
+            hit->nx = nx;
+            hit->ny = ny;
+            break;
+        }
+
+        if (!set) leaving = false;
+
+        if (t_x < t_y) {
+            t = t_x;
+            t_x += t_dx;
+            cx += step_x;
+            nx = -step_x, ny = 0;
+        } else {
+            t = t_y;
+            t_y += t_dy;
+            cy += step_y;
+            nx = 0, ny = -step_y;
+        }
+
+        if (t >= t_exit || cx < 0 || cx >= mask->width || cy < 0 || cy >= mask->height) break;
+    }
+
+    GRFX_STAT_ADD(mask_steps, steps);
+}
+
+// Closest hit, testing the hinted block first when there is one
+static void GRFX_Trace_Hinted(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, int prev_kind, int prev_id, int hint, struct GRFX_Hit *hit) {
+    hit->kind = GRFX_HIT_NONE;
+    hit->id = -1;
+    hit->t = INFINITY;
+
+    // A distance field replaces testing every occluder, mask cells included
+    if (scene->sdf.dist != NULL) {
+        GRFX_Hit_SDF(scene, x1, y1, dx, dy, prev_kind, prev_id, hit);
+    } else {
+        GRFX_Hit_All(scene, x1, y1, dx, dy, prev_kind, prev_id, hint, hit);
+
+        // The mask goes last so its walk can stop at the closest hit so far
+        if (scene->mask.bits != NULL) GRFX_Hit_Mask(scene, x1, y1, dx, dy, hit);
+    }
+
+    if (hit->kind != GRFX_HIT_NONE) {
+        hit->x = x1 + hit->t * dx;
+        hit->y = y1 + hit->t * dy;
+    }
+}
+
+void GRFX_Trace_Closest(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, int prev_kind, int prev_id, struct GRFX_Hit *hit) {
+    GRFX_Trace_Hinted(scene, x1, y1, dx, dy, prev_kind, prev_id, -1, hit);
+}
+
+struct GRFX_Ray *GRFX_Push_Ray(struct GRFX_Ray_Pool *pool, float x, float y, float dx, float dy, float energy, int depth, int prev_kind, int prev_id, int inside) {
+
+    // Out of energy or out of pool space, the branch ends here
+    if (energy < MIN_RAY_ENERGY || depth < 1 || pool->count == pool->capacity) return NULL;
+
+    struct GRFX_Ray *ray = &pool->rays[pool->count++];
+    ray->x = x;
+    ray->y = y;
+    ray->dx = dx;
+    ray->dy = dy;
+    ray->energy = energy;
+    ray->depth = depth;
+    ray->prev_kind = prev_kind;
+    ray->prev_id = prev_id;
+    ray->inside = inside;
+
+    return ray;
+}
+
+void GRFX_Trace_Exit(const SDL_FRect *box, float x1, float y1, float dx, float dy, int id, struct GRFX_Hit *hit) {
+    float t_x = dx > 0 ? (box->x + box->w - x1) / dx : dx < 0 ? (box->x - x1) / dx : INFINITY;
+    float t_y = dy > 0 ? (box->y + box->h - y1) / dy : dy < 0 ? (box->y - y1) / dy : INFINITY;
+
+    hit->kind = GRFX_HIT_BLOCK;
+    hit->id = id;
+
+    // The slab that is left first is the side the ray exits through, normal points out of the box
+    if (t_x < t_y) {
+        hit->t = t_x;
+        hit->nx = dx > 0 ? 1 : -1;
+        hit->ny = 0;
+    } else {
+        hit->t = t_y;
+        hit->nx = 0;
+        hit->ny = dy > 0 ? 1 : -1;
+    }
+
+    hit->x = x1 + hit->t * dx;
+    hit->y = y1 + hit->t * dy;
+}
+
+void GRFX_Trace_Wall(const struct GRFX_Scene *scene, float x1, float y1, float dx, float dy, float *x2, float *y2, float *new_dx, float *new_dy) {
+    float max_width = scene->width, max_height = scene->height;
+    float t_x = dx > 0 ? (max_width - x1) / dx : dx < 0 ? -x1 / dx : INFINITY;
+    float t_y = dy > 0 ? (max_height - y1) / dy : dy < 0 ? -y1 / dy : INFINITY;
+    float t = fmaxf(fminf(t_x, t_y), 0);
+
+    *x2 = x1 + t * dx;
+    *y2 = y1 + t * dy;
+    *new_dx = dx;
+    *new_dy = dy;
+
+    // Fix out of bounds values
+    if (*x2 < 0) *x2 = 0;
+    if (*x2 > max_width) *x2 = max_width;
+    if (*y2 < 0) *y2 = 0;
+    if (*y2 > max_height) *y2 = max_height;
+
+    if (*x2 <= 0 || *x2 >= max_width) {
+        *new_dx = -dx;
+    }
+
+    if (*y2 <= 0 || *y2 >= max_height) {
+        *new_dy = -dy;
+    }
+}
+
+// Count a hit by what it hit
+static inline void GRFX_Count_Hit(const struct GRFX_Hit *hit) {
+    if (hit->kind == GRFX_HIT_BLOCK) {
+        GRFX_STAT_ADD(block_hits, 1);
+        GRFX_STAT_BLOCK_HIT(hit->id);
+    }
+    if (hit->kind == GRFX_HIT_SEGMENT) GRFX_STAT_ADD(segment_hits, 1);
+    if (hit->kind == GRFX_HIT_CIRCLE) GRFX_STAT_ADD(circle_hits, 1);
+    if (hit->kind == GRFX_HIT_NONE) GRFX_STAT_ADD(wall_hits, 1);
+}
+
+// Tests and steps this thread has spent finding hits so far, 0 without stats
+static inline Uint64 GRFX_Trace_Work(void) {
+#ifdef GRFX_NO_STATS
+    return 0;
+#else
+    return grfx_stats->slab_tests + grfx_stats->node_tests + grfx_stats->segment_tests + grfx_stats->circle_tests +
+        grfx_stats->sdf_steps + grfx_stats->mask_steps;
+#endif
+}
+
+// The pool's hit cache for n rays, or NULL when it is off or was warmed for fewer rays. Rays it has not seen yet get no hints.
+static Sint32 *GRFX_Hit_Hints(struct GRFX_Ray_Pool *pool, int n) {
+    return pool->warm && n <= pool->hint_rays ? pool->hints : NULL;
+}
+
+// One segment per ray with no bounces: nothing to split, so the ray tree and the pool's records are skipped
+static int GRFX_Trace_Primary(const struct GRFX_Scene *scene, struct GRFX_Ray_Pool *pool, const struct GRFX_Ray_Query *rays, int n, struct GRFX_Ray_Segment *out, int max_out) {
+    Sint32 *hints = GRFX_Hit_Hints(pool, n);
+    int num_out = 0;
+
+    for (int i = 0; i < n && num_out < max_out; i++) {
+        struct GRFX_Hit hit;
+        float x2 = 0, y2 = 0, new_dx, new_dy;
+        Uint64 work = GRFX_Trace_Work();
+
+        GRFX_STAT_ADD(rays, 1);
+        GRFX_Trace_Hinted(scene, rays[i].x, rays[i].y, rays[i].dx, rays[i].dy, GRFX_HIT_NONE, -1, hints != NULL ? hints[i * HIT_CACHE_SLOTS] : -1, &hit);
+        GRFX_Count_Hit(&hit);
+        if (hints != NULL) hints[i * HIT_CACHE_SLOTS] = hit.kind == GRFX_HIT_BLOCK ? hit.id : -1;
+
+        if (hit.kind != GRFX_HIT_NONE) {
+            x2 = hit.x;
+            y2 = hit.y;
+        } else {
+            GRFX_Trace_Wall(scene, rays[i].x, rays[i].y, rays[i].dx, rays[i].dy, &x2, &y2, &new_dx, &new_dy);
+        }
+
+        out[num_out++] = (struct GRFX_Ray_Segment){ rays[i].x, rays[i].y, x2, y2, 1.0f, i, hit.kind, hit.id, (Uint32)(GRFX_Trace_Work() - work) + 1 };
+        GRFX_STAT_ADD(segments, 1);
+    }
+
+    return num_out;
+}
+
+int GRFX_Trace_Rays(const struct GRFX_Scene *scene, struct GRFX_Ray_Pool *pool, const struct GRFX_Ray_Query *rays, int n, int depth, struct GRFX_Ray_Segment *out, int max_out) {
+    int num_out = 0;
+
+    if (depth == 1) return GRFX_Trace_Primary(scene, pool, rays, n, out, max_out);
+
+    Sint32 *hints = GRFX_Hit_Hints(pool, n);
+
+    // Ray records are scratch, they only live for one call
+    pool->count = 0;
+
+    for (int i = 0; i < n; i++) {
+        int head = pool->count;
+        int root = head;
+
+        GRFX_Push_Ray(pool, rays[i].x, rays[i].y, rays[i].dx, rays[i].dy, 1.0f, depth, GRFX_HIT_NONE, -1, -1);
+        GRFX_STAT_ADD(rays, 1);
+
+        // Walk the ray tree breadth first, children are appended behind the head
+        while (head < pool->count && num_out < max_out) {
+            if (head != root) GRFX_STAT_ADD(bounces, 1);
+
+            // Paths are walked in the same order every trace, so a ray's nth record is usually the same bounce as last time
+            Sint32 *hint = hints != NULL && head - root < HIT_CACHE_SLOTS ? &hints[i * HIT_CACHE_SLOTS + head - root] : NULL;
+            struct GRFX_Ray ray = pool->rays[head++];
+            float x2, y2;
+            float new_dx = ray.dx, new_dy = ray.dy;
+            struct GRFX_Hit hit;
+            Uint64 work = GRFX_Trace_Work();
+
+            if (ray.inside >= 0) {
+                GRFX_Trace_Exit(&scene->blocks[ray.inside], ray.x, ray.y, ray.dx, ray.dy, ray.inside, &hit);
+            } else {
+                GRFX_Trace_Hinted(scene, ray.x, ray.y, ray.dx, ray.dy, ray.prev_kind, ray.prev_id, hint != NULL ? *hint : -1, &hit);
+            }
+
+            if (hint != NULL) *hint = hit.kind == GRFX_HIT_BLOCK && ray.inside < 0 ? hit.id : -1;
+
+            if (hit.kind != GRFX_HIT_NONE) {
+                x2 = hit.x;
+                y2 = hit.y;
+            }
+
+            GRFX_Count_Hit(&hit);
+
+            // If no collisions, extend to the wall
+            if (hit.kind == GRFX_HIT_NONE) {
+                GRFX_Trace_Wall(scene, ray.x, ray.y, ray.dx, ray.dy, &x2, &y2, &new_dx, &new_dy);
+            }
+
+            out[num_out].x1 = ray.x;
+            out[num_out].y1 = ray.y;
+            out[num_out].x2 = x2;
+            out[num_out].y2 = y2;
+            out[num_out].energy = ray.energy;
+            out[num_out].ray = i;
+            out[num_out].hit_kind = hit.kind;
+            out[num_out].hit_id = hit.id;
+            out[num_out].cost = (Uint32)(GRFX_Trace_Work() - work) + 1;
+            num_out++;
+            GRFX_STAT_ADD(segments, 1);
+
+            if (hit.kind == GRFX_HIT_NONE) {
+                GRFX_Push_Ray(pool, x2, y2, new_dx, new_dy, ray.energy, ray.depth - 1, GRFX_HIT_NONE, -1, -1);
+                continue;
+            }
+
+            // Face the normal against the ray
+            float nx = hit.nx, ny = hit.ny;
+            float cos_i = -(ray.dx * nx + ray.dy * ny);
+            if (cos_i < 0) {
+                nx = -nx;
+                ny = -ny;
+                cos_i = -cos_i;
+            }
+
+            float refl_dx = ray.dx + 2 * cos_i * nx;
+            float refl_dy = ray.dy + 2 * cos_i * ny;
+            float ior = hit.kind == GRFX_HIT_BLOCK ? scene->block_ior[hit.id] : 0;
+
+            // Opaque occluders are mirrors
+            if (ior <= 0) {
+                GRFX_Push_Ray(pool, x2, y2, refl_dx, refl_dy, ray.energy, ray.depth - 1, hit.kind, hit.id, -1);
+                continue;
+            }
+
+            // Glass: split into reflected and refracted children by Snell's law and Fresnel (Schlick) weights
+            float n1 = ray.inside >= 0 ? ior : 1.0f;
+            float n2 = ray.inside >= 0 ? 1.0f : ior;
+            float eta = n1 / n2;
+            float k = 1 - eta * eta * (1 - cos_i * cos_i);
+            float reflectance = 1;
+            float refr_dx = 0, refr_dy = 0;
+
+            if (k >= 0) {
+                float cos_t = sqrtf(k);
+                float r0 = (n1 - n2) / (n1 + n2);
+                float c = 1 - (n1 > n2 ? cos_t : cos_i);
+                r0 *= r0;
+                reflectance = r0 + (1 - r0) * c * c * c * c * c;
+                refr_dx = eta * ray.dx + (eta * cos_i - cos_t) * nx;
+                refr_dy = eta * ray.dy + (eta * cos_i - cos_t) * ny;
+            }
+
+            if (ray.inside >= 0) {
+                // Leaving the block: reflection stays inside, refraction skips the block it left
+                GRFX_Push_Ray(pool, x2, y2, refl_dx, refl_dy, ray.energy * reflectance, ray.depth - 1, GRFX_HIT_NONE, -1, ray.inside);
+                GRFX_Push_Ray(pool, x2, y2, refr_dx, refr_dy, ray.energy * (1 - reflectance), ray.depth - 1, GRFX_HIT_BLOCK, hit.id, -1);
+            } else {
+                GRFX_Push_Ray(pool, x2, y2, refl_dx, refl_dy, ray.energy * reflectance, ray.depth - 1, GRFX_HIT_BLOCK, hit.id, -1);
+                GRFX_Push_Ray(pool, x2, y2, refr_dx, refr_dy, ray.energy * (1 - reflectance), ray.depth - 1, GRFX_HIT_NONE, -1, hit.id);
+            }
+        }
+    }
+
+    return num_out;
+}
+
+void GRFX_Trace_Hits(const struct GRFX_Scene *scene, const struct GRFX_Ray_Query *rays, int n, struct GRFX_Hit *hits) {
+    for (int i = 0; i < n; i++) {
+        GRFX_Trace_Closest(scene, rays[i].x, rays[i].y, rays[i].dx, rays[i].dy, GRFX_HIT_NONE, -1, &hits[i]);
+        GRFX_STAT_ADD(rays, 1);
+    }
+}
+
+float GRFX_Trace_Soft_Shadow(const struct GRFX_Scene *scene, float x1, float y1, float x2, float y2, float r) {
+    const struct GRFX_SDF *sdf = &scene->sdf;
+    float dx = x2 - x1, dy = y2 - y1;
+    float len = sqrtf(dx * dx + dy * dy);
+
+    if (sdf->dist == NULL || len <= r) return 1;
+
+    dx /= len, dy /= len;
+
+    // Start a cell out so the surface the point sits on doesn't shadow it
+    float t = sdf->cell, visible = 1;
+    int steps = 0;
+
+    // At t the light's cone is r * t / len wide, an occluder closer to the line than that covers part of it
+    while (t < len - r && visible > -1 && steps < SDF_MAX_STEPS) {
+        int cx = SDL_clamp((int)((x1 + t * dx) / sdf->cell), 0, sdf->width - 1);
+        int cy = SDL_clamp((int)((y1 + t * dy) / sdf->cell), 0, sdf->height - 1);
+        float d = sdf->dist[cy * sdf->width + cx];
+
+        visible = fminf(visible, d * len / (r * t));
+        t += fmaxf(d, 0.5f * sdf->cell);
+        steps++;
+    }
+
+    GRFX_STAT_ADD(sdf_steps, steps);
+
+    return SDL_clamp(0.5f + 0.5f * visible, 0.0f, 1.0f);
+}
+
+#pragma endregion Trace Def
+
+#pragma region Visibility Def
+
+#define SHADOW_INV_MAX 1e30f
+
+// Four shadow rays traced together: origins, unit directions towards the lights, their reciprocals and how far
+// away the lights are. Lanes past the end of the batch have a length of 0 and never count as occluded.
+struct GRFX_Shadow_Packet {
+    float x[4];
+    float y[4];
+    float dx[4];
+    float dy[4];
+    float inv_dx[4];
+    float inv_dy[4];
+    float len[4];
+#ifdef SDL_SSE_INTRINSICS
+    __m128 v_x, v_y, v_dx, v_dy, v_inv_dx, v_inv_dy, v_far, v_eps;
+#endif
+};
+
+// Lanes whose ray crosses the box strictly between its ends. A ray leaving a face it starts on crosses nothing,
+// one starting inside crosses it. Also right for BVH nodes, since blocks are never entered before their node.
+static inline int GRFX_Shadow_Box(const struct GRFX_Shadow_Packet *p, float x_min, float y_min, float x_max, float y_max) {
+#ifdef SDL_SSE_INTRINSICS
+    __m128 t_x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(x_min), p->v_x), p->v_inv_dx);
+    __m128 t_x2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(x_max), p->v_x), p->v_inv_dx);
+    __m128 t_y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(y_min), p->v_y), p->v_inv_dy);
+    __m128 t_y2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(y_max), p->v_y), p->v_inv_dy);
+    __m128 t_near = _mm_max_ps(_mm_min_ps(t_x1, t_x2), _mm_min_ps(t_y1, t_y2));
+    __m128 t_far = _mm_min_ps(_mm_max_ps(t_x1, t_x2), _mm_max_ps(t_y1, t_y2));
+    __m128 mask = _mm_and_ps(_mm_cmple_ps(t_near, t_far), _mm_cmpgt_ps(t_far, p->v_eps));
+
+    return _mm_movemask_ps(_mm_and_ps(mask, _mm_cmplt_ps(t_near, p->v_far)));
+#else
+    int lanes = 0;
+
+    for (int i = 0; i < 4; i++) {
+        float t_x1 = (x_min - p->x[i]) * p->inv_dx[i], t_x2 = (x_max - p->x[i]) * p->inv_dx[i];
+        float t_y1 = (y_min - p->y[i]) * p->inv_dy[i], t_y2 = (y_max - p->y[i]) * p->inv_dy[i];
+        float t_near = fmaxf(fminf(t_x1, t_x2), fminf(t_y1, t_y2));
+        float t_far = fminf(fmaxf(t_x1, t_x2), fmaxf(t_y1, t_y2));
+
+        if (t_near <= t_far && t_far > RAY_EPSILON && t_near < p->len[i] - RAY_EPSILON) lanes |= 1 << i;
+    }
+
+    return lanes;
+#endif
+}
+
+// Lanes whose ray crosses segment i strictly between its ends
+static inline int GRFX_Shadow_Segment(const struct GRFX_Shadow_Packet *p, const struct GRFX_Segments *segs, int i) {
+#ifdef SDL_SSE_INTRINSICS
+    __m128 ex = _mm_set1_ps(segs->x2[i] - segs->x1[i]), ey = _mm_set1_ps(segs->y2[i] - segs->y1[i]);
+    __m128 qx = _mm_sub_ps(_mm_set1_ps(segs->x1[i]), p->v_x), qy = _mm_sub_ps(_mm_set1_ps(segs->y1[i]), p->v_y);
+    __m128 denom = _mm_sub_ps(_mm_mul_ps(p->v_dx, ey), _mm_mul_ps(p->v_dy, ex));
+    __m128 t = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(qx, ey), _mm_mul_ps(qy, ex)), denom);
+    __m128 s = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(qx, p->v_dy), _mm_mul_ps(qy, p->v_dx)), denom);
+
+    __m128 mask = _mm_cmpneq_ps(denom, _mm_setzero_ps());
+    mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t, p->v_eps), _mm_cmplt_ps(t, p->v_far)));
+    mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(s, _mm_setzero_ps()), _mm_cmple_ps(s, _mm_set1_ps(1.0f))));
+
+    return _mm_movemask_ps(mask);
+#else
+    float ex = segs->x2[i] - segs->x1[i], ey = segs->y2[i] - segs->y1[i];
+    int lanes = 0;
+
+    for (int k = 0; k < 4; k++) {
+        float qx = segs->x1[i] - p->x[k], qy = segs->y1[i] - p->y[k];
+        float denom = p->dx[k] * ey - p->dy[k] * ex;
+
+        if (denom == 0) continue;
+
+        float t = (qx * ey - qy * ex) / denom;
+        float s = (qx * p->dy[k] - qy * p->dx[k]) / denom;
+
+        if (t > RAY_EPSILON && t < p->len[k] - RAY_EPSILON && s >= 0 && s <= 1) lanes |= 1 << k;
+    }
+
+    return lanes;
+#endif
+}
+
+// Lanes whose ray passes through circle i between its ends, or starts inside it
+static inline int GRFX_Shadow_Circle(const struct GRFX_Shadow_Packet *p, const struct GRFX_Circles *circles, int i) {
+#ifdef SDL_SSE_INTRINSICS
+    __m128 fx = _mm_sub_ps(p->v_x, _mm_set1_ps(circles->x[i])), fy = _mm_sub_ps(p->v_y, _mm_set1_ps(circles->y[i]));
+    __m128 b = _mm_add_ps(_mm_mul_ps(fx, p->v_dx), _mm_mul_ps(fy, p->v_dy));
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_set1_ps(circles->r[i] * circles->r[i]));
+    __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), c);
+    __m128 root = _mm_sqrt_ps(_mm_max_ps(disc, _mm_setzero_ps()));
+    __m128 t_near = _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), root), t_far = _mm_add_ps(_mm_sub_ps(_mm_setzero_ps(), b), root);
+
+    __m128 mask = _mm_cmpge_ps(disc, _mm_setzero_ps());
+    mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t_far, p->v_eps), _mm_cmplt_ps(t_near, p->v_far)));
+
+    return _mm_movemask_ps(mask);
+#else
+    int lanes = 0;
+
+    for (int k = 0; k < 4; k++) {
+        float fx = p->x[k] - circles->x[i], fy = p->y[k] - circles->y[i];
+        float b = fx * p->dx[k] + fy * p->dy[k];
+        float disc = b * b - (fx * fx + fy * fy - circles->r[i] * circles->r[i]);
+
+        if (disc < 0) continue;
+
+        float root = sqrtf(disc);
+        if (-b + root > RAY_EPSILON && -b - root < p->len[k] - RAY_EPSILON) lanes |= 1 << k;
+    }
+
+    return lanes;
+#endif
+}
+
+// Drop the lanes any block occludes, walking the BVH while any lane is left. Returns the lanes still lit.
+static int GRFX_Shadow_Blocks(const struct GRFX_Scene *scene, const struct GRFX_Shadow_Packet *p, int lit) {
+    const struct GRFX_BVH *bvh = &scene->bvh;
+    int nodes = 0, slabs = 0;
+
+    if (scene->num_blocks < BVH_MIN_BLOCKS || bvh->num_blocks != scene->num_blocks) {
+        for (int i = 0; i < scene->num_blocks && lit; i++, slabs++) {
+            const SDL_FRect *box = &scene->blocks[i];
+            lit &= ~GRFX_Shadow_Box(p, box->x, box->y, box->x + box->w, box->y + box->h);
+        }
+
+        GRFX_STAT_ADD(slab_tests, slabs);
+        return lit;
+    }
+
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+
+    stack[top++] = 0;
+
+    while (top > 0 && lit) {
+        const struct GRFX_BVH_Node *node = &bvh->nodes[stack[--top]];
+
+        if (node->count > 0) {
+            for (int i = node->first; i < node->first + node->count && lit; i++, slabs++) {
+                const SDL_FRect *box = &scene->blocks[bvh->indices[i]];
+                lit &= ~GRFX_Shadow_Box(p, box->x, box->y, box->x + box->w, box->y + box->h);
+            }
+            continue;
+        }
+
+        // Any order will do, the first occluder found is enough
+        for (int c = 0; c < 2; c++) {
+            const struct GRFX_BVH_Node *child = &bvh->nodes[node->first + c];
+            if (GRFX_Shadow_Box(p, child->x_min, child->y_min, child->x_max, child->y_max) & lit) stack[top++] = node->first + c;
+        }
+        nodes += 2;
+    }
+
+    GRFX_STAT_ADD(node_tests, nodes);
+    GRFX_STAT_ADD(slab_tests, slabs);
+
+    return lit;
+}
+
+void GRFX_Trace_Visibility(const struct GRFX_Scene *scene, const struct GRFX_Visibility_Query *queries, int n, Uint64 *visible) {
+    memset(visible, 0, (size_t)(n + 63) / 64 * sizeof(Uint64));
+
+    for (int first = 0; first < n; first += 4) {
+        struct GRFX_Shadow_Packet p;
+        int lit = 0;
+
+        for (int k = 0; k < 4; k++) {
+            const struct GRFX_Visibility_Query *q = &queries[SDL_min(first + k, n - 1)];
+            float dx = q->light_x - q->x, dy = q->light_y - q->y;
+            float len = first + k < n ? sqrtf(dx * dx + dy * dy) : 0;
+
+            p.x[k] = q->x;
+            p.y[k] = q->y;
+            p.dx[k] = len > 0 ? dx / len : 1;
+            p.dy[k] = len > 0 ? dy / len : 0;
+            p.len[k] = len;
+            if (first + k < n) lit |= 1 << k;
+
+            // A zero component gets a huge but finite reciprocal: an origin on a slab plane then gives t = 0
+            // instead of 0 * inf = NaN, and the ray counts as inside that slab like in GRFX_Hit_Block
+            p.inv_dx[k] = SDL_clamp(1.0f / p.dx[k], -SHADOW_INV_MAX, SHADOW_INV_MAX);
+            p.inv_dy[k] = SDL_clamp(1.0f / p.dy[k], -SHADOW_INV_MAX, SHADOW_INV_MAX);
+        }
+
+#ifdef SDL_SSE_INTRINSICS
+        p.v_x = _mm_loadu_ps(p.x);
+        p.v_y = _mm_loadu_ps(p.y);
+        p.v_dx = _mm_loadu_ps(p.dx);
+        p.v_dy = _mm_loadu_ps(p.dy);
+        p.v_inv_dx = _mm_loadu_ps(p.inv_dx);
+        p.v_inv_dy = _mm_loadu_ps(p.inv_dy);
+        p.v_eps = _mm_set1_ps(RAY_EPSILON);
+        p.v_far = _mm_sub_ps(_mm_loadu_ps(p.len), p.v_eps);
+#endif
+
+        lit = GRFX_Shadow_Blocks(scene, &p, lit);
+
+        for (int i = 0; i < scene->segments.count && lit; i++) {
+            lit &= ~GRFX_Shadow_Segment(&p, &scene->segments, i);
+            GRFX_STAT_ADD(segment_tests, 1);
+        }
+
+        for (int i = 0; i < scene->circles.count && lit; i++) {
+            lit &= ~GRFX_Shadow_Circle(&p, &scene->circles, i);
+            GRFX_STAT_ADD(circle_tests, 1);
+        }
+
+        // The mask walk is one ray at a time, and only for what is still lit
+        for (int k = 0; k < 4 && scene->mask.bits != NULL; k++) {
+            struct GRFX_Hit hit = { .kind = GRFX_HIT_NONE, .id = -1, .t = p.len[k] - RAY_EPSILON };
+
+            if (!(lit & (1 << k))) continue;
+
+            GRFX_Hit_Mask(scene, p.x[k], p.y[k], p.dx[k], p.dy[k], &hit);
+            if (hit.kind == GRFX_HIT_MASK) lit &= ~(1 << k);
+        }
+
+        visible[first / 64] |= (Uint64)lit << (first % 64);
+    }
+
+    GRFX_STAT_ADD(rays, n);
+}
+
+#pragma endregion Visibility Def
+
+#pragma region MAF Def
+
+int MAF_Distance(int x1, int y1, int x2, int y2 ) {
+    return (int)sqrt((double)(x2 - x1) * (x2 -x1) + (y2 - y1) * (y2 - y1));
+}
+
+int MAF_Ray_Segments(const struct GRFX_Segments *segs, float ox, float oy, float dx, float dy, int skip, float *t_hit) {
+    // Ray o + t*d against segment p + s*e: t = cross(p - o, e) / cross(d, e), s = cross(p - o, d) / cross(d, e)
+    float best_t = INFINITY;
+    int best = -1;
+    int i = 0;
+
+#ifdef SDL_SSE_INTRINSICS
+    const __m128 v_ox = _mm_set1_ps(ox), v_oy = _mm_set1_ps(oy);
+    const __m128 v_dx = _mm_set1_ps(dx), v_dy = _mm_set1_ps(dy);
+    const __m128 v_zero = _mm_setzero_ps(), v_one = _mm_set1_ps(1.0f);
+    const __m128 v_eps = _mm_set1_ps(RAY_EPSILON), v_skip = _mm_set1_ps((float)skip);
+    const __m128 v_step = _mm_set1_ps(4.0f);
+    __m128 v_best_t = _mm_set1_ps(INFINITY);
+    __m128 v_best_i = _mm_set1_ps(-1.0f);
+    __m128 v_i = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    for (; i + 4 <= segs->count; i += 4) {
+        __m128 px = _mm_loadu_ps(segs->x1 + i), py = _mm_loadu_ps(segs->y1 + i);
+        __m128 ex = _mm_sub_ps(_mm_loadu_ps(segs->x2 + i), px);
+        __m128 ey = _mm_sub_ps(_mm_loadu_ps(segs->y2 + i), py);
+        __m128 qx = _mm_sub_ps(px, v_ox), qy = _mm_sub_ps(py, v_oy);
+
+        __m128 denom = _mm_sub_ps(_mm_mul_ps(v_dx, ey), _mm_mul_ps(v_dy, ex));
+        __m128 t = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(qx, ey), _mm_mul_ps(qy, ex)), denom);
+        __m128 s = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(qx, v_dy), _mm_mul_ps(qy, v_dx)), denom);
+
+        __m128 mask = _mm_cmpneq_ps(denom, v_zero);
+        mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, v_eps));
+        mask = _mm_and_ps(mask, _mm_cmplt_ps(t, v_best_t));
+        mask = _mm_and_ps(mask, _mm_cmpge_ps(s, v_zero));
+        mask = _mm_and_ps(mask, _mm_cmple_ps(s, v_one));
+        mask = _mm_and_ps(mask, _mm_cmpneq_ps(v_i, v_skip));
+
+        v_best_t = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, v_best_t));
+        v_best_i = _mm_or_ps(_mm_and_ps(mask, v_i), _mm_andnot_ps(mask, v_best_i));
+        v_i = _mm_add_ps(v_i, v_step);
+    }
+
+    // Reduce the 4 lanes
+    float lane_t[4], lane_i[4];
+    _mm_storeu_ps(lane_t, v_best_t);
+    _mm_storeu_ps(lane_i, v_best_i);
+    for (int lane = 0; lane < 4; lane++) {
+        if (lane_i[lane] >= 0 && lane_t[lane] < best_t) {
+            best_t = lane_t[lane];
+            best = (int)lane_i[lane];
+        }
+    }
+#endif
+
+    // Scalar tail (or everything without SSE)
+    for (; i < segs->count; i++) {
+        if (i == skip) continue;
+
+        float ex = segs->x2[i] - segs->x1[i], ey = segs->y2[i] - segs->y1[i];
+        float qx = segs->x1[i] - ox, qy = segs->y1[i] - oy;
+        float denom = dx * ey - dy * ex;
+
+        if (denom == 0) continue;
+
+        float t = (qx * ey - qy * ex) / denom;
+        float s = (qx * dy - qy * dx) / denom;
+
+        if (t > RAY_EPSILON && t < best_t && s >= 0 && s <= 1) {
+            best_t = t;
+            best = i;
+        }
+    }
+
+    *t_hit = best_t;
+    return best;
+}
+
+int MAF_Ray_Circles(const struct GRFX_Circles *circles, float ox, float oy, float dx, float dy, int skip, float *t_hit) {
+    // With a unit direction, |o + t*d - c|^2 = r^2 gives t = -b -+ sqrt(b^2 - c)
+    float best_t = INFINITY;
+    int best = -1;
+    int i = 0;
+
+#ifdef SDL_SSE_INTRINSICS
+    const __m128 v_ox = _mm_set1_ps(ox), v_oy = _mm_set1_ps(oy);
+    const __m128 v_dx = _mm_set1_ps(dx), v_dy = _mm_set1_ps(dy);
+    const __m128 v_zero = _mm_setzero_ps();
+    const __m128 v_eps = _mm_set1_ps(RAY_EPSILON), v_skip = _mm_set1_ps((float)skip);
+    const __m128 v_step = _mm_set1_ps(4.0f);
+    __m128 v_best_t = _mm_set1_ps(INFINITY);
+    __m128 v_best_i = _mm_set1_ps(-1.0f);
+    __m128 v_i = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    for (; i + 4 <= circles->count; i += 4) {
+        __m128 fx = _mm_sub_ps(v_ox, _mm_loadu_ps(circles->x + i));
+        __m128 fy = _mm_sub_ps(v_oy, _mm_loadu_ps(circles->y + i));
+        __m128 r = _mm_loadu_ps(circles->r + i);
+
+        __m128 b = _mm_add_ps(_mm_mul_ps(fx, v_dx), _mm_mul_ps(fy, v_dy));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(r, r));
+        __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), c);
+        __m128 root = _mm_sqrt_ps(_mm_max_ps(disc, v_zero));
+
+        // Take the near root, or the far one when starting inside the circle
+        __m128 t_near = _mm_sub_ps(_mm_sub_ps(v_zero, b), root);
+        __m128 t_far = _mm_add_ps(_mm_sub_ps(v_zero, b), root);
+        __m128 use_near = _mm_cmpgt_ps(t_near, v_eps);
+        __m128 t = _mm_or_ps(_mm_and_ps(use_near, t_near), _mm_andnot_ps(use_near, t_far));
+
+        __m128 mask = _mm_cmpge_ps(disc, v_zero);
+        mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, v_eps));
+        mask = _mm_and_ps(mask, _mm_cmplt_ps(t, v_best_t));
+        mask = _mm_and_ps(mask, _mm_cmpneq_ps(v_i, v_skip));
+
+        v_best_t = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, v_best_t));
+        v_best_i = _mm_or_ps(_mm_and_ps(mask, v_i), _mm_andnot_ps(mask, v_best_i));
+        v_i = _mm_add_ps(v_i, v_step);
+    }
+
+    // Reduce the 4 lanes
+    float lane_t[4], lane_i[4];
+    _mm_storeu_ps(lane_t, v_best_t);
+    _mm_storeu_ps(lane_i, v_best_i);
+    for (int lane = 0; lane < 4; lane++) {
+        if (lane_i[lane] >= 0 && lane_t[lane] < best_t) {
+            best_t = lane_t[lane];
+            best = (int)lane_i[lane];
+        }
+    }
+#endif
+
+    // Scalar tail (or everything without SSE)
+    for (; i < circles->count; i++) {
+        if (i == skip) continue;
+
+        float fx = ox - circles->x[i], fy = oy - circles->y[i];
+        float b = fx * dx + fy * dy;
+        float c = fx * fx + fy * fy - circles->r[i] * circles->r[i];
+        float disc = b * b - c;
+
+        if (disc < 0) continue;
+
+        float root = sqrtf(disc);
+        float t = -b - root;
+        if (t <= RAY_EPSILON) t = -b + root;
+
+        if (t > RAY_EPSILON && t < best_t) {
+            best_t = t;
+            best = i;
+        }
+    }
+
+    *t_hit = best_t;
+    return best;
+}
+
+bool MAF_Clip_Segment(const SDL_FRect *box, float *x1, float *y1, float *x2, float *y2) {
+    float dx = *x2 - *x1, dy = *y2 - *y1;
+    float p[4] = { -dx, dx, -dy, dy };
+    float q[4] = { *x1 - box->x, box->x + box->w - *x1, *y1 - box->y, box->y + box->h - *y1 };
+    float t0 = 0, t1 = 1;
+
+    // Shrink [t0, t1] against each of the four edges
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            if (q[i] < 0) return false;
+            continue;
+        }
+
+        float t = q[i] / p[i];
+        if (p[i] < 0) {
+            if (t > t1) return false;
+            if (t > t0) t0 = t;
+        } else {
+            if (t < t0) return false;
+            if (t < t1) t1 = t;
+        }
+    }
+
+    *x2 = *x1 + t1 * dx;
+    *y2 = *y1 + t1 * dy;
+    *x1 = *x1 + t0 * dx;
+    *y1 = *y1 + t0 * dy;
+
+    return true;
+}
+
+void MAF_Disk_Sample(int i, float r, float *x, float *y) {
+    // R2 sequence, the plastic number generalization of the golden ratio
+    const double a1 = 0.7548776662466927, a2 = 0.5698402909980532;
+    double u = fmod(0.5 + a1 * i, 1.0);
+    double v = fmod(0.5 + a2 * i, 1.0);
+    double rad = r * sqrt(u);
+
+    *x = rad * cos(2 * M_PI * v);
+    *y = rad * sin(2 * M_PI * v);
+}
+
+#pragma endregion MAF Def
@@ -0,0 +1,126 @@
+#pragma region Include
+
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Workers Def
+
+static int GRFX_Worker_Main(void *data) {
+    struct GRFX_Worker_Arg *arg = data;
+    struct GRFX_Workers *workers = arg->workers;
+    int generation = 0;
+
+    // Counters of this thread go into its own block
+    grfx_stats = &workers->stats[arg->index];
+
+    while (true) {
+        SDL_LockMutex(workers->lock);
+        while (workers->generation == generation && !workers->quit) {
+            SDL_WaitCondition(workers->start, workers->lock);
+        }
+
+        if (workers->quit) {
+            SDL_UnlockMutex(workers->lock);
+            break;
+        }
+
+        generation = workers->generation;
+        SDL_UnlockMutex(workers->lock);
+
+        GRFX_Worker_Run(workers, arg->index);
+
+        SDL_LockMutex(workers->lock);
+        if (--workers->busy == 0) SDL_SignalCondition(workers->done);
+        SDL_UnlockMutex(workers->lock);
+    }
+
+    return 0;
+}
+
+void GRFX_Worker_Run(struct GRFX_Workers *workers, int thread) {
+    int index;
+
+    // Items are handed out one at a time so uneven items still balance
+    while ((index = SDL_AddAtomicInt(&workers->next, 1)) < workers->count) {
+        workers->fn(workers->data, index, thread);
+    }
+}
+
+struct GRFX_Workers *GRFX_Create_Workers(int num_threads) {
+    struct GRFX_Workers *workers = calloc(1, sizeof(struct GRFX_Workers));
+
+    if (num_threads < 1) num_threads = SDL_GetNumLogicalCPUCores();
+    if (num_threads > MAX_WORKERS) num_threads = MAX_WORKERS;
+    if (num_threads < 1) num_threads = 1;
+
+    workers->num_threads = num_threads;
+    workers->lock = SDL_CreateMutex();
+    workers->start = SDL_CreateCondition();
+    workers->done = SDL_CreateCondition();
+
+    // Thread 0 is the caller, the rest get their own threads
+    for (int i = 1; i < num_threads; i++) {
+        workers->args[i].workers = workers;
+        workers->args[i].index = i;
+        GRFX_Stats_Track(&workers->stats[i]);
+        workers->threads[i] = SDL_CreateThread(GRFX_Worker_Main, "worker", &workers->args[i]);
+
+        if (workers->threads[i] == NULL) {
+            workers->num_threads = i;
+            break;
+        }
+    }
+
+    return workers;
+}
+
+void GRFX_Destroy_Workers(struct GRFX_Workers *workers) {
+    if (workers == NULL) return;
+
+    SDL_LockMutex(workers->lock);
+    workers->quit = true;
+    SDL_BroadcastCondition(workers->start);
+    SDL_UnlockMutex(workers->lock);
+
+    for (int i = 1; i < workers->num_threads; i++) {
+        SDL_WaitThread(workers->threads[i], NULL);
+        GRFX_Stats_Untrack(&workers->stats[i]);
+    }
+
+    SDL_DestroyCondition(workers->done);
+    SDL_DestroyCondition(workers->start);
+    SDL_DestroyMutex(workers->lock);
+    free(workers);
+}
+
+void GRFX_Parallel_For(struct GRFX_Workers *workers, int count, void (*fn)(void *data, int index, int thread), void *data) {
+    if (count <= 0) return;
+
+    // Small jobs or a single thread run inline
+    if (workers == NULL || workers->num_threads == 1 || count == 1) {
+        for (int i = 0; i < count; i++) fn(data, i, 0);
+        return;
+    }
+
+    SDL_LockMutex(workers->lock);
+    workers->fn = fn;
+    workers->data = data;
+    workers->count = count;
+    SDL_SetAtomicInt(&workers->next, 0);
+    workers->busy = workers->num_threads - 1;
+    workers->generation++;
+    SDL_BroadcastCondition(workers->start);
+    SDL_UnlockMutex(workers->lock);
+
+    // The calling thread helps out, then waits for the rest
+    GRFX_Worker_Run(workers, 0);
+
+    SDL_LockMutex(workers->lock);
+    while (workers->busy > 0) {
+        SDL_WaitCondition(workers->done, workers->lock);
+    }
+    SDL_UnlockMutex(workers->lock);
+}
+
+#pragma endregion Workers Def
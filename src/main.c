@@ -5,6 +5,7 @@
 #include <math.h>
 #include <string.h>
 #include <SDL3/SDL.h>
+#include "grfx.h"
 
 #pragma endregion Include
 
@@ -12,23 +13,122 @@
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
+#define WORLD_WIDTH 2400
+#define WORLD_HEIGHT 1800
+#define MIN_ZOOM 0.25f
+#define MAX_ZOOM 4.0f
+#define ZOOM_STEP 1.1f
 #define NUM_BLOCKS 5
 #define LIGHT_RADIUS 20
-#define NUM_LIGHT_RAYS 30;
+#define NUM_LIGHT_RAYS 30
 #define NUM_RAY_REFLECTIONS 1
+#define MAX_RAY_REFLECTIONS 16
 #define RAY_OPACITY 50
-#define M_PI 3.14159265358979323846
+#define RENDER_SCALE 1.0f
+#define MIN_RENDER_SCALE 0.125f
+#define MAX_ACCUM_FRAMES 64
+#define FRAME_ARENA_SIZE (8 << 20)
+#define BENCH_WARMUP 30
+#define CAPTURE_POOL_SIZE 8
+
+#define CAPTURE_FORMAT_BMP 0
+#define CAPTURE_FORMAT_RAW 1
+
+#define CAPTURE_DROP 0
+#define CAPTURE_BLOCK 1
+
+#define MOVING_BLOCK_SIZE 12
+#define MOVING_BLOCK_SPEED 120
+
+#define MASK_CELL 4
+
+#define GI_EXPOSURE 6.0f
+
+#define RING_SLOTS 4
+
+#define TILE_SIZE 600
+#define TILE_BUDGET 16
+#define TILE_MARGIN 1
+
+#define TILE_EMPTY 0
+#define TILE_QUEUED 1
+#define TILE_LOADING 2
+#define TILE_READY 3
+
+#define POWER_CHECK_MS 2000
+#define POWER_LOW_PERCENT 20
+#define POWER_BUSY 0.5f
+#define POWER_MAX_LEVEL 2
+
+#define BATCH_MAGIC "GRFXBAT2"
+#define BATCH_RAYS 360
+#define BATCH_DEPTH 4
+#define BATCH_MAX_SEGMENTS (1 << 22)
+#define BATCH_OK 0
+#define BATCH_FAILED 1
+#define BATCH_TRUNCATED 2
 
 #pragma endregion Macros
 
 #pragma region Declare
 
+// World position of the window's top-left corner, render pixels per world unit, the window's size in render
+// pixels and render pixels per window point. zoom includes density, so a world unit keeps its size on any display.
+struct GRFX_Camera {
+    float x;
+    float y;
+    float zoom;
+    int width;
+    int height;
+    float density;
+};
+
+// Window and scene settings from the command line or a config file, the macros are the defaults
+struct GRFX_Config {
+    int window_width;
+    int window_height;
+    int num_blocks;
+    int num_rays;
+    int num_reflections;
+    int ray_opacity;
+    float render_scale;
+};
+
 struct GRFX_GUI {
     SDL_Window *window;
     SDL_Renderer *renderer;
     int running;
     struct GRFX_Light *light;
-    struct SDL_FRect *blocks[NUM_BLOCKS];
+    struct GRFX_Scene scene;
+    struct GRFX_Ray_Pool rays;
+    struct GRFX_Ray_Query *ray_queries;
+    SDL_Color *ray_colors;
+    struct GRFX_Ray_Segment *ray_segments;
+    struct GRFX_Arena frame;
+    SDL_Texture *light_layer;
+    SDL_Texture *accum;
+    int light_width;
+    int light_height;
+    struct GRFX_Camera camera;
+    struct GRFX_Workers *workers;
+    struct GRFX_Raster raster;
+    struct GRFX_Bloom bloom;
+    int bloom_enabled;
+    SDL_Texture *light_pixels;
+    SDL_Texture *mask_texture;
+    struct GRFX_GI gi;
+    SDL_Texture *gi_texture;
+    int gi_enabled;
+    struct GRFX_Heatmap heatmap;
+    SDL_Texture *heatmap_texture;
+    int heatmap_enabled;
+    struct GRFX_Light_Cache light_cache;
+    int light_cache_enabled;
+    struct GRFX_Ring ring;
+    struct GRFX_Ring_Slot *slot;
+    struct GRFX_Ring_Slot *last_slot;
+    struct GRFX_Config config;
+    char cache_path[1024];
 };
 
 struct GRFX_Light {
@@ -37,6 +137,142 @@ struct GRFX_Light {
     int r;
 };
 
+// Command line options
+struct GRFX_Options {
+    struct GRFX_Config config;
+    const char *stats_path;
+    const char *capture_dir;
+    int capture_format;
+    int capture_policy;
+    int moving_blocks;
+    int raster;
+    int bloom;
+    int sdf;
+    int gi;
+    int heatmap;
+    int light_cache;
+    int power;
+    int bench_frames;
+    const char *tile_dir;
+    const char *mask_path;
+    const char *scene_path;
+    int cache;
+    const char *ring_name;
+    const char *batch_list;
+    const char *batch_out;
+    int batch_rays;
+    int batch_depth;
+    int threads;
+};
+
+// A reusable buffer holding one read back frame
+struct GRFX_Capture_Frame {
+    void *pixels;
+    size_t size;
+    int w;
+    int h;
+    int pitch;
+    SDL_PixelFormat format;
+    int number;
+};
+
+// Frame capture: the frame loop fills pooled buffers, a writer thread encodes them to disk
+struct GRFX_Capture {
+    const char *dir;
+    int format;
+    int policy;
+    int enabled;
+    int paused;
+    struct GRFX_Capture_Frame frames[CAPTURE_POOL_SIZE];
+    int free_list[CAPTURE_POOL_SIZE];
+    int num_free;
+    int queue[CAPTURE_POOL_SIZE];
+    int queue_head;
+    int queued;
+    int number;
+    int written;
+    int dropped;
+    int quit;
+    SDL_Mutex *lock;
+    SDL_Condition *cond;
+    SDL_Thread *thread;
+};
+
+// Benchmark run: scripted frames, their times and how many allocations each one made
+struct GRFX_Bench {
+    int frames;
+    int frame;
+    Uint64 *times;
+    Uint64 *allocations;
+};
+
+// Quality policy from the power supply. Each level above 0 halves the frame rate and the rays, drops a
+// reflection and accumulates a quarter of the samples; any level above 0 turns bloom and GI off.
+// On battery the level is 1, 2 when the charge is low, and one more while tracing takes more than
+// POWER_BUSY of the frame. bloom and gi are what was asked for, restored at level 0.
+struct GRFX_Power {
+    int enabled;
+    int level;
+    SDL_PowerState state;
+    float frame_ms;
+    Uint64 next_check;
+    int bloom;
+    int gi;
+};
+
+// A resident world tile: its grid position, load state and occluders
+struct GRFX_Tile {
+    int tx;
+    int ty;
+    int state;
+    Uint64 last_used;
+    struct GRFX_Scene scene;
+};
+
+// Streams tile files from disk on a loader thread, keeping at most TILE_BUDGET of them resident
+struct GRFX_Streamer {
+    const char *dir;
+    int enabled;
+    struct GRFX_Tile tiles[TILE_BUDGET];
+    int changed;
+    Uint64 frame;
+    int loaded;
+    int evicted;
+    int quit;
+    SDL_Mutex *lock;
+    SDL_Condition *cond;
+    SDL_Thread *thread;
+};
+
+// Scratch memory owned by one batch thread, reused for every scene it traces
+struct GRFX_Batch_Scratch {
+    struct GRFX_Scene scene;
+    struct GRFX_Ray_Pool pool;
+    struct GRFX_Ray_Query *queries;
+    struct GRFX_Ray_Segment *segments;
+    int capacity;
+    Uint32 *block_hits;
+    float *block_energy;
+    int block_capacity;
+    Uint8 *record;
+    size_t record_size;
+    size_t record_capacity;
+};
+
+// Offline batch: a list of scene files traced on the worker pool into one binary result file
+struct GRFX_Batch {
+    char **paths;
+    int num_scenes;
+    int num_rays;
+    int depth;
+    int sdf;
+    int cache;
+    FILE *out;
+    SDL_Mutex *lock;
+    int failed;
+    struct GRFX_Batch_Scratch scratch[MAX_WORKERS];
+};
+
 // Initialize SDL Library
 void GRFX_Init();
 
@@ -44,7 +280,66 @@ void GRFX_Init();
 void GRFX_End(struct GRFX_GUI *gui);
 
 // Create a GUI initialized with a window and renderer
-struct GRFX_GUI GRFX_Create_GUI();
+struct GRFX_GUI GRFX_Create_GUI(const struct GRFX_Config *config);
+
+// Scatter n small blocks over the scene with random velocities
+void GRFX_Add_Moving_Blocks(struct GRFX_Scene *scene, int n);
+
+// The part of the world the camera sees
+SDL_FRect GRFX_View_Rect(const struct GRFX_Camera *camera);
+
+// World to window coordinates
+SDL_FPoint GRFX_To_Screen(const struct GRFX_Camera *camera, float x, float y);
+
+// Window to world coordinates
+SDL_FPoint GRFX_To_World(const struct GRFX_Camera *camera, float x, float y);
+
+// Zoom by factor, keeping the world point under the window point (x, y) in place
+void GRFX_Zoom_Camera(struct GRFX_Camera *camera, float factor, float x, float y);
+
+// Fit the camera, the light layers, the rasterizer, bloom and the heatmap to the window's current size in pixels,
+// tracing the light at render_scale of it. Returns false when the light layers could not be made.
+bool GRFX_Resize_GUI(struct GRFX_GUI *gui);
+
+// Draw rays with the tile-binned software rasterizer on num_threads worker threads instead of SDL_RenderLine
+void GRFX_Enable_Raster(struct GRFX_GUI *gui, int num_threads);
+
+// Add a blurred glow of the bright rays to the software rasterizer's framebuffer, which it turns on
+void GRFX_Enable_Bloom(struct GRFX_GUI *gui, int num_threads);
+
+// Replace the built-in occluders with a scene file's, keeping their BVH and distance field in FILE.cache when cache is set
+void GRFX_Enable_Scene(struct GRFX_GUI *gui, const char *path, int cache);
+
+// Load an occupancy mask from a BMP at the world's origin, MASK_CELL units per pixel, and a texture to draw it with
+void GRFX_Enable_Mask(struct GRFX_GUI *gui, const char *path);
+
+// Trace through a distance field of the scene, built and kept up to date on the worker threads
+void GRFX_Enable_SDF(struct GRFX_GUI *gui, int num_threads);
+
+// Light the scene with diffuse bounced light from radiance cascades, marched through the distance field
+void GRFX_Enable_GI(struct GRFX_GUI *gui, int num_threads);
+
+// Mark a region whose occluders changed, or the whole scene when region is NULL
+void GRFX_Invalidate(struct GRFX_GUI *gui, const SDL_FRect *region);
+
+// Tone map the fluence into the GI texture, tinted like the light
+void GRFX_Upload_GI(struct GRFX_GUI *gui);
+
+// Add the GI texture over the view
+void GRFX_Draw_GI(struct GRFX_GUI *gui);
+
+// Color the heatmap of the last traced frame into its texture
+void GRFX_Upload_Heatmap(struct GRFX_GUI *gui);
+
+// Draw the heatmap texture over the window
+void GRFX_Draw_Heatmap(struct GRFX_GUI *gui);
+
+// Publish every frame into a shared-memory ring under name, for other processes to read. Called again when
+// the window outgrows the ring's frames, it replaces the ring with a bigger one.
+void GRFX_Enable_Ring(struct GRFX_GUI *gui, const char *name);
+
+// Copy the read back frame into its ring slot and publish the slot
+void GRFX_Publish_Frame(struct GRFX_GUI *gui, SDL_Surface *surface);
 
 // Clear the renderer with a color
 void GRFX_Clear_GUI(struct GRFX_GUI *gui);
@@ -52,83 +347,302 @@ void GRFX_Clear_GUI(struct GRFX_GUI *gui);
 // Draws a filled in circle with radius r, centered at (c_x, c_y)
 void GRFX_Draw_Circle(SDL_Renderer *renderer, int centerX, int centerY, int radius);
 
-// Render a 'ray' (or line)
-void GRFX_Render_Ray(struct GRFX_GUI *gui, int x1, int y1, double dx, double dy, SDL_FRect *prev_col, int count);
+// Draw the blocks, segments, polygons and circles
+void GRFX_Draw_Occluders(struct GRFX_GUI *gui);
+
+// Trace the fan of rays and draw the resulting segments, each in its ray's color. With cached the
+// segments come from the light cache instead when it covers the light. Returns true when they did.
+bool GRFX_Render_Rays(struct GRFX_GUI *gui, int num_rays, int depth, bool cached);
+
+// Blend the light layer into the running average of the last n frames
+void GRFX_Accumulate(struct GRFX_GUI *gui, int n);
+
+// Parse command line options
+void GRFX_Parse_Args(int argc, char *argv[], struct GRFX_Options *options);
+
+// Read "key value" lines into config: window W H, blocks N, rays N, reflections N, opacity N
+bool GRFX_Load_Config(struct GRFX_Config *config, const char *path);
+
+// Parse a WxH window size
+bool GRFX_Parse_Size(const char *text, int *width, int *height);
+
+// Start the capture writer thread when a capture directory was given
+void GRFX_Capture_Start(struct GRFX_Capture *capture, const struct GRFX_Options *options);
+
+// Copy the read back frame into a pooled buffer and queue it for writing, surface is NULL when the readback failed
+void GRFX_Capture_Frame(struct GRFX_Capture *capture, SDL_Surface *surface);
+
+// Writer thread: encodes queued frames to disk
+int GRFX_Capture_Writer(void *data);
+
+// Flush queued frames and stop the writer thread
+void GRFX_Capture_End(struct GRFX_Capture *capture);
+
+// Draw the last frame's counters as an overlay
+void GRFX_Stats_Draw(SDL_Renderer *renderer);
+
+// Allocate the per-frame records of a benchmark run of n frames, or disable it when n is 0
+void GRFX_Bench_Start(struct GRFX_Bench *bench, int n);
+
+// Record the frame that just ended
+void GRFX_Bench_Frame(struct GRFX_Bench *bench);
+
+// Print frame time percentiles and steady-state allocations, returns 1 when a frame after warmup allocated
+int GRFX_Bench_End(struct GRFX_Bench *bench);
 
-// Distance between (x1,y1) and (x2,y2)
-int MAF_Distance(int x1, int y1, int x2, int y2 );
+// Follow the power supply when asked to, starting at full quality with the effects the GUI has on
+void GRFX_Power_Start(struct GRFX_Power *power, const struct GRFX_Options *options, const struct GRFX_GUI *gui);
+
+// Feed the policy a frame's cost, 0 for frames that did not trace. Every POWER_CHECK_MS it reads the power
+// supply and picks a level, switching the GUI's effects to match. Returns true when the level changed.
+bool GRFX_Power_Update(struct GRFX_Power *power, struct GRFX_GUI *gui, Uint64 frame_ns);
+
+// How many of num_rays and num_reflections to trace at the current level
+int GRFX_Power_Rays(const struct GRFX_Power *power, int num_rays);
+int GRFX_Power_Reflections(const struct GRFX_Power *power, int num_reflections);
+
+// qsort order for Uint64
+int GRFX_Compare_Uint64(const void *a, const void *b);
+
+// Start the tile loader thread when a tile directory was given
+void GRFX_Stream_Start(struct GRFX_Streamer *streamer, const struct GRFX_Options *options);
+
+// Queue the tiles around the view and the light, evicting the least recently used ones.
+// Returns true when the set of loaded tiles changed since the last call.
+bool GRFX_Stream_Update(struct GRFX_Streamer *streamer, SDL_FRect view, float light_x, float light_y);
+
+// Rebuild the scene from its base occluders plus every loaded tile
+void GRFX_Stream_Compose(struct GRFX_Streamer *streamer, struct GRFX_Scene *scene, struct GRFX_Scene_Mark base);
+
+// Loader thread: reads queued tiles from disk
+int GRFX_Stream_Loader(void *data);
+
+// Stop the loader thread and free the tiles
+void GRFX_Stream_End(struct GRFX_Streamer *streamer);
+
+// Trace every scene in the batch list without opening a window, returns the process exit code
+int GRFX_Batch_Run(const struct GRFX_Options *options);
+
+// Worker job: load, trace and write the record of one scene
+void GRFX_Batch_Scene(void *data, int index, int thread);
+
+// Append bytes to a thread's record buffer
+void GRFX_Batch_Put(struct GRFX_Batch_Scratch *scratch, const void *bytes, size_t size);
 
 #pragma endregion Declare
 
 int main(int argc, char *argv[]) {
 
+    struct GRFX_Options options;
+    struct GRFX_Capture capture;
+    struct GRFX_Streamer streamer;
+    struct GRFX_Power power;
+    struct GRFX_Bench bench;
+
+    // Count allocations from the very start, before SDL makes any
+    GRFX_Alloc_Init();
+
+    GRFX_Parse_Args(argc, argv, &options);
+
+    // Batch mode never opens a window
+    if (options.batch_list != NULL) return GRFX_Batch_Run(&options);
+
     // Initialize SDL
     GRFX_Init();
 
     // Create GUI with window and renderer
-    struct GRFX_GUI gui = GRFX_Create_GUI();
+    struct GRFX_GUI gui = GRFX_Create_GUI(&options.config);
+    if (options.scene_path != NULL) GRFX_Enable_Scene(&gui, options.scene_path, options.cache);
+    GRFX_Add_Moving_Blocks(&gui.scene, options.moving_blocks);
+    if (options.raster) GRFX_Enable_Raster(&gui, options.threads);
+    if (options.bloom) GRFX_Enable_Bloom(&gui, options.threads);
+    if (options.mask_path != NULL) GRFX_Enable_Mask(&gui, options.mask_path);
+    if (options.sdf) GRFX_Enable_SDF(&gui, options.threads);
+    if (options.gi) GRFX_Enable_GI(&gui, options.threads);
+    gui.heatmap_enabled = options.heatmap;
+    gui.light_cache_enabled = options.light_cache;
+    if (gui.cache_path[0] != 0 && gui.scene.sdf.dist == NULL) GRFX_Open_Cache(&gui.scene, gui.cache_path, 0, NULL);
+    if (options.ring_name != NULL) GRFX_Enable_Ring(&gui, options.ring_name);
+
+    // Streamed tiles are appended behind the scene's own occluders
+    struct GRFX_Scene_Mark base = GRFX_Mark_Scene(&gui.scene);
+    GRFX_Stream_Start(&streamer, &options);
+    GRFX_Capture_Start(&capture, &options);
+    GRFX_Bench_Start(&bench, options.bench_frames);
+    GRFX_Power_Start(&power, &options, &gui);
+    GRFX_Stats_Init();
     SDL_Event event;
     int dragging = -1;
     int startX = 0, startY = 0;
-    int center_x = WINDOW_WIDTH / 2 - LIGHT_RADIUS;
-    int center_y = WINDOW_HEIGHT / 2 - LIGHT_RADIUS;
-    int num_rays = NUM_LIGHT_RAYS;
-    int num_reflections = NUM_RAY_REFLECTIONS;
+    int center_x = gui.config.window_width / 2 - LIGHT_RADIUS;
+    int center_y = gui.config.window_height / 2 - LIGHT_RADIUS;
+    int num_rays = gui.config.num_rays;
+    int num_reflections = gui.config.num_reflections;
+    int accum_frames = 0;
+    int show_stats = false;
+    int animating = options.moving_blocks > 0;
+    int panning = false;
+    SDL_FPoint mouse;
+    Uint64 frame_start = SDL_GetTicksNS();
+    Uint64 last_frame;
 
     while (gui.running) {
-        // Handle events
+        last_frame = frame_start;
+        frame_start = SDL_GetTicksNS();
+
+        // Everything in the frame arena only lives for this frame
+        GRFX_Arena_Reset(&gui.frame);
+
+        // Segments are traced straight into this frame's ring slot
+        if (gui.ring.header != NULL) gui.slot = GRFX_Ring_Begin(&gui.ring);
+
+        // Benchmarks orbit the light so every frame traces
+        if (bench.frames > 0) {
+            center_x = gui.config.window_width / 2 + 150 * cos(bench.frame * 0.05);
+            center_y = gui.config.window_height / 2 + 150 * sin(bench.frame * 0.05);
+            accum_frames = 0;
+        }
+
+        // Handle events, with mouse positions in render pixels like the camera
         while (SDL_PollEvent(&event)) {
+            SDL_ConvertEventToRenderCoordinates(gui.renderer, &event);
+
             switch (event.type) {
                 case SDL_EVENT_QUIT:
                     gui.running = false;
                     break;
+                case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+                    // Resized or moved to a display of another density: trace the new view from scratch
+                    if (!GRFX_Resize_GUI(&gui)) {
+                        printf("SDL_CreateTexture Error: %s\n", SDL_GetError());
+                        gui.running = false;
+                    }
+                    accum_frames = 0;
+                    break;
                 case SDL_EVENT_MOUSE_BUTTON_DOWN:
+                    // The light and blocks live in the world, so picking happens there
+                    mouse = GRFX_To_World(&gui.camera, event.button.x, event.button.y);
+
+                    // Middle drag pans the camera
+                    if (event.button.button == SDL_BUTTON_MIDDLE) panning = true;
+
                     if (event.button.button == SDL_BUTTON_LEFT) {
-                        if(MAF_Distance(center_x, center_y, event.button.x, event.button.y) < LIGHT_RADIUS) {
-                            dragging = NUM_BLOCKS;
-                            startX = event.button.x - center_x;
-                            startY = event.button.y - center_y;
+                        if(MAF_Distance(center_x, center_y, mouse.x, mouse.y) < LIGHT_RADIUS) {
+                            dragging = gui.config.num_blocks;
+                            startX = mouse.x - center_x;
+                            startY = mouse.y - center_y;
+
+                            // Light paths over the view are baked once, dragging then only looks them up
+                            SDL_FRect view = GRFX_View_Rect(&gui.camera);
+                            int rays = GRFX_Power_Rays(&power, num_rays), reflections = GRFX_Power_Reflections(&power, num_reflections);
+                            if (gui.light_cache_enabled && !animating && !GRFX_Light_Cache_Valid(&gui.light_cache, &gui.scene, view, rays, reflections)) {
+                                GRFX_Update_BVH(&gui.scene);
+                                GRFX_Update_SDF(&gui.scene, gui.workers);
+                                GRFX_Bake_Light_Cache(&gui.light_cache, &gui.scene, view, LIGHT_CACHE_CELL, rays, reflections, gui.workers);
+                            }
                             break;
                         }
 
-                        for (int i = 0; i < NUM_BLOCKS; i++) {
-                            if(event.button.x >= gui.blocks[i]->x && event.button.x <= gui.blocks[i]->x + gui.blocks[i]->w && event.button.y >= gui.blocks[i]->y && event.button.y <= gui.blocks[i]->y + gui.blocks[i]->h) {
+                        for (int i = 0; i < gui.config.num_blocks; i++) {
+                            if(mouse.x >= gui.scene.blocks[i].x && mouse.x <= gui.scene.blocks[i].x + gui.scene.blocks[i].w && mouse.y >= gui.scene.blocks[i].y && mouse.y <= gui.scene.blocks[i].y + gui.scene.blocks[i].h) {
                                 dragging = i;
-                                startX = event.button.x - gui.blocks[i]->x;
-                                startY = event.button.y - gui.blocks[i]->y;
+                                startX = mouse.x - gui.scene.blocks[i].x;
+                                startY = mouse.y - gui.scene.blocks[i].y;
+                            }
+                        }
+                    }
+
+                    // Right click toggles a block between mirror and glass
+                    if (event.button.button == SDL_BUTTON_RIGHT) {
+                        for (int i = 0; i < gui.config.num_blocks; i++) {
+                            if(mouse.x >= gui.scene.blocks[i].x && mouse.x <= gui.scene.blocks[i].x + gui.scene.blocks[i].w && mouse.y >= gui.scene.blocks[i].y && mouse.y <= gui.scene.blocks[i].y + gui.scene.blocks[i].h) {
+                                gui.scene.block_ior[i] = gui.scene.block_ior[i] > 0 ? 0 : GLASS_IOR;
+                                accum_frames = 0;
                             }
                         }
                     }
                     break;
                 case SDL_EVENT_MOUSE_MOTION:
-                    if (dragging == NUM_BLOCKS) {
-                        center_x = event.motion.x - startX;
-                        center_y = event.motion.y - startY;
+                    mouse = GRFX_To_World(&gui.camera, event.motion.x, event.motion.y);
+
+                    if (panning) {
+                        gui.camera.x -= event.motion.xrel / gui.camera.zoom;
+                        gui.camera.y -= event.motion.yrel / gui.camera.zoom;
+                        accum_frames = 0;
+                    }
+
+                    if (dragging == gui.config.num_blocks) {
+                        center_x = mouse.x - startX;
+                        center_y = mouse.y - startY;
                     }
 
-                    if (dragging >= 0 && dragging < NUM_BLOCKS) {
-                        gui.blocks[dragging]->x = event.motion.x - startX;
-                        gui.blocks[dragging]->y = event.motion.y - startY;
+                    if (dragging >= 0 && dragging < gui.config.num_blocks) {
+                        // The distance field and GI only need redoing where the block was and where it is now
+                        GRFX_Invalidate(&gui, &gui.scene.blocks[dragging]);
+                        gui.scene.blocks[dragging].x = mouse.x - startX;
+                        gui.scene.blocks[dragging].y = mouse.y - startY;
+                        GRFX_Invalidate(&gui, &gui.scene.blocks[dragging]);
                     }
 
+                    // Scene changed, restart accumulating
+                    if (dragging != -1) accum_frames = 0;
+
                     break;
                 case SDL_EVENT_MOUSE_BUTTON_UP:
                     if (event.button.button == SDL_BUTTON_LEFT && dragging != -1) {
+                        // Frames traced from the light cache are approximate, trace it properly where it was let go
+                        if (dragging == gui.config.num_blocks && gui.light_cache_enabled) accum_frames = 0;
                         dragging = -1;
                     }
+
+                    if (event.button.button == SDL_BUTTON_MIDDLE) panning = false;
                     break;
                 case SDL_EVENT_MOUSE_WHEEL:
-                        num_rays += event.wheel.y * 5;
-                        if (num_rays < 2) {
-                            num_rays == 2;
+                        // Ctrl + wheel zooms around the cursor, the wheel alone changes the ray count
+                        if (SDL_GetModState() & SDL_KMOD_CTRL) {
+                            GRFX_Zoom_Camera(&gui.camera, powf(ZOOM_STEP, event.wheel.y), event.wheel.mouse_x, event.wheel.mouse_y);
+                            accum_frames = 0;
+                            break;
                         }
+
+                        num_rays = SDL_clamp(num_rays + (int)(event.wheel.y * 5), 2, RAY_POOL_SIZE / num_reflections);
+                        accum_frames = 0;
                     break;
                 case SDL_EVENT_KEY_DOWN:
                     if (strcmp(SDL_GetKeyName(event.key.key), "Up") == 0) num_reflections++;
 
                     if (strcmp(SDL_GetKeyName(event.key.key), "Down") == 0) num_reflections--;
 
-                    if (num_reflections < 1) num_reflections = 1;
+                    // Every reflection of the whole fan has to fit in the ray pool
+                    num_reflections = SDL_clamp(num_reflections, 1, MAX_RAY_REFLECTIONS);
+                    num_rays = SDL_min(num_rays, RAY_POOL_SIZE / num_reflections);
+
+                    // S shows and hides the stats overlay
+                    if (strcmp(SDL_GetKeyName(event.key.key), "S") == 0) {
+                        show_stats = !show_stats;
+                        break;
+                    }
+
+                    // H shows and hides the tracer cost heatmap, traced again so it is current
+                    if (strcmp(SDL_GetKeyName(event.key.key), "H") == 0) {
+                        gui.heatmap_enabled = !gui.heatmap_enabled;
+                        accum_frames = 0;
+                        break;
+                    }
+
+                    // M pauses and resumes the moving blocks
+                    if (strcmp(SDL_GetKeyName(event.key.key), "M") == 0) {
+                        animating = !animating;
+                        break;
+                    }
+
+                    // C pauses and resumes capturing
+                    if (strcmp(SDL_GetKeyName(event.key.key), "C") == 0) {
+                        capture.paused = !capture.paused;
+                        break;
+                    }
+
+                    accum_frames = 0;
 
                     break;
                 default:
@@ -136,81 +650,174 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        // Clear GUI before rendering next frame
-        GRFX_Clear_GUI(&gui);
+        // Moving blocks change the scene every frame
+        if (animating) {
+            GRFX_Animate_Blocks(&gui.scene, (frame_start - last_frame) / 1e9f);
+            GRFX_Invalidate(&gui, NULL);
+            accum_frames = 0;
+        }
+
+        // Swap tiles in and out around the view and the light
+        if (GRFX_Stream_Update(&streamer, GRFX_View_Rect(&gui.camera), center_x, center_y)) {
+            GRFX_Stream_Compose(&streamer, &gui.scene, base);
+            GRFX_Invalidate(&gui, NULL);
+            accum_frames = 0;
+        }
 
-        SDL_SetRenderDrawColor(gui.renderer, 30, 30, 30, 255);
+        // Bounced light settles over a few frames after every change, then costs nothing
+        if (gui.gi_enabled) {
+            gui.scene.light_x = center_x;
+            gui.scene.light_y = center_y;
+            gui.scene.light_r = LIGHT_RADIUS;
+            GRFX_Update_SDF(&gui.scene, gui.workers);
 
-        for(int i = 0; i < NUM_BLOCKS; i++) {
-            SDL_RenderFillRect(gui.renderer, gui.blocks[i]);
+            if (GRFX_Update_GI(&gui.gi, &gui.scene, GRFX_View_Rect(&gui.camera), gui.workers)) GRFX_Upload_GI(&gui);
         }
 
         SDL_SetRenderDrawBlendMode(gui.renderer, SDL_BLENDMODE_BLEND);
 
-        double rad = 0, dx, dy;
-        float x1, y1, x2, y2;
-        float r = 255, g = 0, b = 0;
-        float dc = 255 * 6 / num_rays;
+        // Trace one more light sample until the accumulated image has converged, sooner at lower power levels
+        int rays = GRFX_Power_Rays(&power, num_rays), reflections = GRFX_Power_Reflections(&power, num_reflections);
+        bool traced = accum_frames < MAX_ACCUM_FRAMES >> (2 * power.level);
 
-        for (int i = 0; i < num_rays; i++) {
-            dx = cos(rad);
-            dy = sin(rad);
+        if (traced) {
+            // The software rasterizer clears its own framebuffer
+            if (gui.light_pixels == NULL) {
+                SDL_SetRenderTarget(gui.renderer, gui.light_layer);
+                SDL_SetRenderDrawColor(gui.renderer, 0, 0, 0, 255);
+                SDL_RenderClear(gui.renderer);
+            }
 
-            // Set color
-            SDL_SetRenderDrawColor(gui.renderer, r, g, b, RAY_OPACITY);
+            // Per-ray buffers come from the frame arena
+            gui.ray_queries = GRFX_Arena_Alloc(&gui.frame, rays * sizeof(struct GRFX_Ray_Query));
+            gui.ray_colors = GRFX_Arena_Alloc(&gui.frame, rays * sizeof(SDL_Color));
+
+            double rad = 0, dx, dy;
+            float ox, oy;
+            float r = 255, g = 0, b = 0;
+            float dc = 255 * 6 / rays;
+
+            for (int i = 0; i < rays; i++) {
+                dx = cos(rad);
+                dy = sin(rad);
+
+                // The first sample starts at the center, later ones spread over the light's disk
+                ox = 0, oy = 0;
+                if (accum_frames > 0) {
+                    MAF_Disk_Sample(accum_frames * rays + i, LIGHT_RADIUS, &ox, &oy);
+                }
+
+                // Set color
+                gui.ray_colors[i] = (SDL_Color){ r, g, b, gui.config.ray_opacity };
+
+                gui.ray_queries[i] = (struct GRFX_Ray_Query){ center_x + ox, center_y + oy, dx, dy };
+
+                // Increment the radians by 2PI / Number of rays
+                rad += 2 * M_PI / rays;
+
+                if (r == 255 && g < 255 && b == 0) {
+                    g += dc;
+                    if (g > 255) g = 255;
+                    continue;
+                }
+
+                if (r > 0 && g == 255 && b == 0) {
+                    r -= dc;
+                    if (r < 0) r = 0;
+                    continue;
+                }
+
+                if (r == 0 && g == 255 && b < 255) {
+                    b += dc;
+                    if (b > 255) b = 255;
+                    continue;
+                }
+
+                if (r == 0 && g > 0 && b == 255) {
+                    g -= dc;
+                    if (g < 0) g = 0;
+                    continue;
+                }
+
+                if (r < 255 && g == 0 && b == 255) {
+                    r += dc;
+                    if (r > 255) r = 255;
+                    continue;
+                }
+
+                if (r == 255 && g == 0 && b > 0) {
+                    b -= dc;
+                    if (b < 0) b = 0;
+                }
+            }
 
-            GRFX_Render_Ray(&gui, center_x, center_y, dx, dy, NULL, num_reflections);
+            // Blocks may have been dragged or moved since the last trace
+            GRFX_Update_BVH(&gui.scene);
+            GRFX_Update_SDF(&gui.scene, gui.workers);
 
-            // Increment the radians by 2PI / Number of rays
-            rad += 2 * M_PI / num_rays;
+            // While the light is dragged its first sample can come from the light cache, as long as it was baked for
+            // these rays and these blocks: a lower ray count would look up rays past this frame's colors
+            bool cached = accum_frames == 0 && dragging == gui.config.num_blocks && !animating &&
+                GRFX_Light_Cache_Valid(&gui.light_cache, &gui.scene, GRFX_View_Rect(&gui.camera), rays, reflections);
+            cached = GRFX_Render_Rays(&gui, rays, reflections, cached);
 
-            if (r == 255 && g < 255 && b == 0) {
-                g += dc;
-                if (g > 255) g = 255;
-                continue;
-            }
+            GRFX_Accumulate(&gui, accum_frames++);
 
-            if (r > 0 && g == 255 && b == 0) {
-                r -= dc;
-                if (r < 0) r = 0;
-                continue;
-            }
+            // No more samples on top of a cached frame, letting go of the light traces it again
+            if (cached) accum_frames = MAX_ACCUM_FRAMES;
+        }
 
-            if (r == 0 && g == 255 && b < 255) {
-                b += dc;
-                if (b > 255) b = 255;
-                continue;
-            }
+        // Clear GUI before rendering next frame
+        GRFX_Clear_GUI(&gui);
 
-            if (r == 0 && g > 0 && b == 255) {
-                g -= dc;
-                if (g < 0) g = 0;
-                continue;
-            }
+        if (gui.gi_enabled) GRFX_Draw_GI(&gui);
 
-            if (r < 255 && g == 0 && b == 255) {
-                r += dc;
-                if (r > 255) r = 255;
-                continue;
-            }
+        GRFX_Draw_Occluders(&gui);
 
-            if (r == 255 && g == 0 && b > 0) {
-                b -= dc;
-                if (b < 0) b = 0;
-            }
-        }
+        // Light is added on top of the scene
+        SDL_RenderTexture(gui.renderer, gui.accum, NULL, NULL);
+        GRFX_STAT_ADD(draw_calls, 1);
+
+        if (gui.heatmap_enabled) GRFX_Draw_Heatmap(&gui);
+
+        if (show_stats) GRFX_Stats_Draw(gui.renderer);
+
+        // One readback serves both capture and the ring
+        SDL_Surface *pixels = (capture.enabled && !capture.paused) || gui.slot != NULL ? SDL_RenderReadPixels(gui.renderer, NULL) : NULL;
+
+        GRFX_Capture_Frame(&capture, pixels);
+
+        if (gui.slot != NULL) GRFX_Publish_Frame(&gui, pixels);
+
+        SDL_DestroySurface(pixels);
 
         // Present the renderer (show rendered content on screen)
         SDL_RenderPresent(gui.renderer);
 
-        // Limit frame rate (approx. 60 FPS)
-        SDL_Delay(16);
+        // A new power level retraces the light at its quality
+        if (GRFX_Power_Update(&power, &gui, traced ? SDL_GetTicksNS() - frame_start : 0)) accum_frames = 0;
+
+        GRFX_Stats_Frame_End(SDL_GetTicksNS() - frame_start);
+
+        // Benchmarks run flat out and stop by themselves
+        if (bench.frames > 0) {
+            GRFX_Bench_Frame(&bench);
+            if (bench.frame == bench.frames) gui.running = false;
+            continue;
+        }
+
+        // Limit frame rate (approx. 60 FPS, halved at every power level)
+        SDL_Delay(16 << power.level);
     }
 
     // End
+    GRFX_Capture_End(&capture);
+    GRFX_Stream_End(&streamer);
+    if (options.stats_path != NULL) GRFX_Stats_Dump(options.stats_path);
+    GRFX_Stats_End();
     GRFX_End(&gui);
 
-    return 0;
+    return GRFX_Bench_End(&bench);
 }
 
 #pragma region GRFX Def
@@ -223,13 +830,36 @@ void GRFX_Init() {
 }
 
 void GRFX_End(struct GRFX_GUI *gui){
-    // Free blocks
-    for (int i = 0; i < NUM_BLOCKS; i++) {
-        free(gui->blocks[i]);
-    }
+    // Free scene
+    GRFX_Destroy_Scene(&gui->scene);
 
     // Free light
     free(gui->light);
+
+    // Free the frame arena holding the ray pool and per-ray buffers
+    GRFX_Destroy_Arena(&gui->frame);
+    free(gui->rays.hints);
+
+    SDL_DestroyTexture(gui->light_layer);
+    SDL_DestroyTexture(gui->accum);
+
+    // Free the software rasterizer
+    GRFX_Destroy_Workers(gui->workers);
+    GRFX_Destroy_Raster(&gui->raster);
+    GRFX_Destroy_Bloom(&gui->bloom);
+    SDL_DestroyTexture(gui->light_pixels);
+    SDL_DestroyTexture(gui->mask_texture);
+
+    // Free the cascades
+    GRFX_Destroy_GI(&gui->gi);
+    SDL_DestroyTexture(gui->gi_texture);
+
+    GRFX_Destroy_Heatmap(&gui->heatmap);
+    SDL_DestroyTexture(gui->heatmap_texture);
+    GRFX_Destroy_Light_Cache(&gui->light_cache);
+
+    // Readers keep the last frames, the name goes away
+    GRFX_Ring_Close(&gui->ring);
     
     SDL_DestroyRenderer(gui->renderer);
 
@@ -238,15 +868,16 @@ void GRFX_End(struct GRFX_GUI *gui){
     SDL_Quit();
 }
 
-struct GRFX_GUI GRFX_Create_GUI() {
+struct GRFX_GUI GRFX_Create_GUI(const struct GRFX_Config *config) {
     struct GRFX_GUI new_gui;
+    int width = config->window_width, height = config->window_height;
 
     // Create an SDL window
     new_gui.window = SDL_CreateWindow(
         "Grafx",           
-        WINDOW_WIDTH,                     
-        WINDOW_HEIGHT,
-        SDL_WINDOW_RESIZABLE
+        width,                     
+        height,
+        SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIGH_PIXEL_DENSITY
     );
 
     // If window is null, exit
@@ -273,16 +904,73 @@ struct GRFX_GUI GRFX_Create_GUI() {
 
     new_gui.light = malloc(sizeof(struct GRFX_Light));
     new_gui.light->r = LIGHT_RADIUS;
-    new_gui.light->x = WINDOW_WIDTH / 2 - LIGHT_RADIUS;
-    new_gui.light->y = WINDOW_HEIGHT / 2 - LIGHT_RADIUS;
+    new_gui.light->x = width / 2 - LIGHT_RADIUS;
+    new_gui.light->y = height / 2 - LIGHT_RADIUS;
     
-    // Create some blocks
-    for (int i = 0; i < NUM_BLOCKS; i++) {
-        new_gui.blocks[i] = malloc(sizeof(struct SDL_FRect));
-        new_gui.blocks[i]->x = i * 100;
-        new_gui.blocks[i]->y = 0;
-        new_gui.blocks[i]->w = 60;
-        new_gui.blocks[i]->h = 60;
+    // The world is bigger than the window, rays bounce off its walls wherever the camera is
+    new_gui.scene = GRFX_Create_Scene(WORLD_WIDTH, WORLD_HEIGHT);
+    new_gui.camera = (struct GRFX_Camera){ 0, 0, 1, width, height, 1 };
+    new_gui.config = *config;
+    new_gui.workers = NULL;
+    new_gui.raster = (struct GRFX_Raster){ 0 };
+    new_gui.bloom = (struct GRFX_Bloom){ 0 };
+    new_gui.bloom_enabled = false;
+    new_gui.light_pixels = NULL;
+    new_gui.mask_texture = NULL;
+    new_gui.gi = (struct GRFX_GI){ 0 };
+    new_gui.gi_texture = NULL;
+    new_gui.gi_enabled = false;
+    new_gui.heatmap = (struct GRFX_Heatmap){ 0 };
+    new_gui.heatmap_texture = NULL;
+    new_gui.heatmap_enabled = false;
+    new_gui.light_cache = (struct GRFX_Light_Cache){ 0 };
+    new_gui.light_cache_enabled = false;
+    new_gui.ring = (struct GRFX_Ring){ 0 };
+    new_gui.slot = NULL;
+    new_gui.last_slot = NULL;
+    new_gui.cache_path[0] = 0;
+
+    // Create some blocks, one of them glass
+    for (int i = 0; i < config->num_blocks; i++) {
+        GRFX_Add_Block(&new_gui.scene, i * 100, 0, 60, 60, i == 2 ? GLASS_IOR : 0);
+    }
+    new_gui.config.num_blocks = new_gui.scene.num_blocks;
+
+    // Ray pool, segment and per-ray buffers come from the frame arena, so frames don't touch the heap
+    new_gui.frame = GRFX_Create_Arena(FRAME_ARENA_SIZE);
+    new_gui.rays = (struct GRFX_Ray_Pool){ .rays = NULL, .count = 0, .capacity = RAY_POOL_SIZE, .warm = false, .hints = NULL, .hint_rays = 0 };
+
+    // Rays barely move between frames, so each one tests what it hit last time first
+    GRFX_Warm_Ray_Pool(&new_gui.rays, RAY_POOL_SIZE);
+    new_gui.ray_segments = NULL;
+    new_gui.ray_queries = NULL;
+    new_gui.ray_colors = NULL;
+
+    // Create some rotated walls, a hexagon and a round pillar
+    GRFX_Add_Segment(&new_gui.scene, 100, 450, 250, 520);
+    GRFX_Add_Segment(&new_gui.scene, 600, 380, 700, 540);
+
+    float hexagon[12];
+    for (int i = 0; i < 6; i++) {
+        hexagon[i * 2] = 620 + 45 * cos(i * M_PI / 3);
+        hexagon[i * 2 + 1] = 180 + 45 * sin(i * M_PI / 3);
+    }
+    GRFX_Add_Polygon(&new_gui.scene, hexagon, 6);
+
+    GRFX_Add_Circle(&new_gui.scene, 200, 250, 30);
+
+    // The light layers and everything else sized by the window are made for its size in pixels
+    new_gui.light_layer = NULL;
+    new_gui.accum = NULL;
+    new_gui.light_width = 0;
+    new_gui.light_height = 0;
+
+    if (!GRFX_Resize_GUI(&new_gui)) {
+        printf("SDL_CreateTexture Error: %s\n", SDL_GetError());
+        SDL_DestroyRenderer(new_gui.renderer);
+        SDL_DestroyWindow(new_gui.window);
+        SDL_Quit();
+        exit(1);
     }
 
     // Setting gui as 'running'
@@ -291,123 +979,1396 @@ struct GRFX_GUI GRFX_Create_GUI() {
     return new_gui;
 }
 
-void GRFX_Clear_GUI(struct GRFX_GUI *gui) {
-    SDL_SetRenderDrawColor(gui->renderer, 0, 0, 0, 0);
-    SDL_RenderClear(gui->renderer);
+void GRFX_Add_Moving_Blocks(struct GRFX_Scene *scene, int n) {
+    for (int i = 0; i < n; i++) {
+        float x = SDL_randf() * (scene->width - MOVING_BLOCK_SIZE);
+        float y = SDL_randf() * (scene->height - MOVING_BLOCK_SIZE);
+        float angle = SDL_randf() * 2 * M_PI;
+        float speed = MOVING_BLOCK_SPEED * (0.5f + SDL_randf());
+        int id = GRFX_Add_Block(scene, x, y, MOVING_BLOCK_SIZE, MOVING_BLOCK_SIZE, 0);
+
+        GRFX_Set_Block_Velocity(scene, id, speed * cos(angle), speed * sin(angle));
+    }
 }
 
-void GRFX_Draw_Circle(SDL_Renderer *renderer, int c_x, int c_y, int r) {
-    for (int y = -r; y <= r; y++) {
-        int dx = (int)sqrt(r * r - y * y);
-        for (int x = -dx; x <= dx; x++) {
-            SDL_RenderPoint(renderer, c_x + x, c_y + y);
-        }
+SDL_FRect GRFX_View_Rect(const struct GRFX_Camera *camera) {
+    return (SDL_FRect){ camera->x, camera->y, camera->width / camera->zoom, camera->height / camera->zoom };
+}
+
+SDL_FPoint GRFX_To_Screen(const struct GRFX_Camera *camera, float x, float y) {
+    return (SDL_FPoint){ (x - camera->x) * camera->zoom, (y - camera->y) * camera->zoom };
+}
+
+SDL_FPoint GRFX_To_World(const struct GRFX_Camera *camera, float x, float y) {
+    return (SDL_FPoint){ camera->x + x / camera->zoom, camera->y + y / camera->zoom };
+}
+
+void GRFX_Zoom_Camera(struct GRFX_Camera *camera, float factor, float x, float y) {
+    SDL_FPoint anchor = GRFX_To_World(camera, x, y);
+
+    camera->zoom *= factor;
+    if (camera->zoom < MIN_ZOOM * camera->density) camera->zoom = MIN_ZOOM * camera->density;
+    if (camera->zoom > MAX_ZOOM * camera->density) camera->zoom = MAX_ZOOM * camera->density;
+
+    camera->x = anchor.x - x / camera->zoom;
+    camera->y = anchor.y - y / camera->zoom;
+}
+
+bool GRFX_Resize_GUI(struct GRFX_GUI *gui) {
+    struct GRFX_Camera *camera = &gui->camera;
+    float density = SDL_GetWindowPixelDensity(gui->window);
+    int width, height;
+
+    if (!SDL_GetRenderOutputSize(gui->renderer, &width, &height) || width <= 0 || height <= 0) return gui->light_layer != NULL;
+
+    // Moving to a display of another density keeps the world the same size on screen
+    if (density > 0) {
+        camera->zoom *= density / camera->density;
+        camera->density = density;
+    }
+
+    camera->width = width;
+    camera->height = height;
+
+    // Frames are published uncropped, a window bigger than the ring's frames gets a new ring
+    const struct GRFX_Ring_Header *header = gui->ring.header;
+    if (header != NULL && ((Uint32)width > header->max_width || (Uint32)height > header->max_height)) GRFX_Enable_Ring(gui, gui->ring.name);
+
+    // The heatmap's cells are window pixels
+    if (gui->heatmap.width != (width + HEATMAP_CELL - 1) / HEATMAP_CELL || gui->heatmap.height != (height + HEATMAP_CELL - 1) / HEATMAP_CELL) {
+        GRFX_Destroy_Heatmap(&gui->heatmap);
+        SDL_DestroyTexture(gui->heatmap_texture);
+        gui->heatmap = GRFX_Create_Heatmap(width, height, HEATMAP_CELL);
+        gui->heatmap_texture = NULL;
+    }
+
+    // Light is traced at render_scale of the window and stretched over it
+    int light_width = SDL_max((int)(width * gui->config.render_scale), 1), light_height = SDL_max((int)(height * gui->config.render_scale), 1);
+    if (light_width == gui->light_width && light_height == gui->light_height && gui->light_layer != NULL) return true;
+
+    gui->light_width = light_width;
+    gui->light_height = light_height;
+
+    // Averaged over frames, in half floats where the renderer allows it
+    SDL_DestroyTexture(gui->light_layer);
+    SDL_DestroyTexture(gui->accum);
+    gui->light_layer = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA64_FLOAT, SDL_TEXTUREACCESS_TARGET, light_width, light_height);
+    gui->accum = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA64_FLOAT, SDL_TEXTUREACCESS_TARGET, light_width, light_height);
+
+    if (gui->light_layer == NULL || gui->accum == NULL) {
+        SDL_DestroyTexture(gui->light_layer);
+        SDL_DestroyTexture(gui->accum);
+        gui->light_layer = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, light_width, light_height);
+        gui->accum = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, light_width, light_height);
+    }
+
+    if (gui->light_layer == NULL || gui->accum == NULL) return false;
+
+    SDL_SetTextureBlendMode(gui->light_layer, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureBlendMode(gui->accum, SDL_BLENDMODE_ADD);
+    SDL_SetTextureScaleMode(gui->accum, SDL_SCALEMODE_LINEAR);
+
+    // The rasterizer and bloom draw into the light layer, so they follow it
+    if (gui->light_pixels != NULL) {
+        SDL_DestroyTexture(gui->light_pixels);
+        gui->light_pixels = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, light_width, light_height);
+        if (gui->light_pixels != NULL) SDL_SetTextureBlendMode(gui->light_pixels, SDL_BLENDMODE_BLEND);
+
+        GRFX_Destroy_Raster(&gui->raster);
+        gui->raster = GRFX_Create_Raster(light_width, light_height);
+    }
+
+    if (gui->bloom.bright != NULL) {
+        GRFX_Destroy_Bloom(&gui->bloom);
+        gui->bloom = GRFX_Create_Bloom(light_width, light_height);
     }
+
+    return true;
 }
 
-void GRFX_Render_Ray(struct GRFX_GUI *gui, int x1, int y1, double dx, double dy, SDL_FRect *prev_col, int count) {
+void GRFX_Enable_Raster(struct GRFX_GUI *gui, int num_threads) {
+    gui->light_pixels = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, gui->light_width, gui->light_height);
 
-    if (count < 1) return;
+    if (gui->light_pixels == NULL) {
+        printf("SDL_CreateTexture Error: %s\n", SDL_GetError());
+        return;
+    }
 
-    float x2, y2;
-    double new_dx = dx, new_dy = dy;
-    float max_width = WINDOW_WIDTH, max_height = WINDOW_HEIGHT;
-    const double epsilon = 0.001;
+    SDL_SetTextureBlendMode(gui->light_pixels, SDL_BLENDMODE_BLEND);
+    gui->raster = GRFX_Create_Raster(gui->light_width, gui->light_height);
+    gui->workers = GRFX_Create_Workers(num_threads);
+}
 
-    SDL_FRect *box;
-    float temp, t_near, t_far;
-    float x_min, x_max, y_min, y_max;
-    float t_x1, t_y1, t_x2, t_y2;
-    SDL_FRect *box_collision = NULL;
-    float box_collision_dist = INFINITY;
+void GRFX_Enable_Bloom(struct GRFX_GUI *gui, int num_threads) {
+    if (gui->light_pixels == NULL) GRFX_Enable_Raster(gui, num_threads);
+    if (gui->light_pixels == NULL) return;
 
-    // Check for box collisions
-    for (int i = 0; i < NUM_BLOCKS; i++) {
-        box = gui->blocks[i];
+    gui->bloom = GRFX_Create_Bloom(gui->raster.width, gui->raster.height);
+    gui->bloom_enabled = gui->bloom.bright != NULL;
+}
 
-        if (box == prev_col) continue;
+void GRFX_Enable_Scene(struct GRFX_GUI *gui, const char *path, int cache) {
+    struct GRFX_Scene scene = GRFX_Create_Scene(gui->scene.width, gui->scene.height);
 
-        x_min = box->x, x_max = box->x + box->w, y_min = box->y, y_max = box->y + box->h;
-        t_x1 = (x_min - x1) / dx;
-        t_x2 = (x_max - x1) / dx;
-        t_y1 = (y_min - y1) / dy;
-        t_y2 = (y_max - y1) / dy;
+    // The file is loaded on the side, so one that fails to parse leaves the current scene whole
+    if (GRFX_Load_Scene(&scene, path)) {
+        GRFX_Destroy_Scene(&gui->scene);
+        gui->scene = scene;
+        if (cache) SDL_snprintf(gui->cache_path, sizeof(gui->cache_path), "%s.cache", path);
+    }
+    else {
+        printf("%s\n", SDL_GetError());
+        GRFX_Destroy_Scene(&scene);
+    }
 
-        if (t_x1 > t_x2) {
-            temp = t_x1; t_x1 = t_x2; t_x2 = temp;
-        }
+    // Every block of the scene can be dragged
+    gui->config.num_blocks = gui->scene.num_blocks;
+}
 
-        if (t_y1 > t_y2) {
-            temp = t_y1; t_y1 = t_y2; t_y2 = temp;
-        }
+void GRFX_Enable_Mask(struct GRFX_GUI *gui, const char *path) {
+    struct GRFX_Mask *mask = &gui->scene.mask;
 
-        t_near = fmaxf(t_x1, t_y1);
-        t_far = fminf(t_x2, t_y2);
+    if (!GRFX_Load_Mask(&gui->scene, path, 0, 0, MASK_CELL)) {
+        printf("Could not load mask %s: %s\n", path, SDL_GetError());
+        return;
+    }
 
-        if (t_near <= t_far && t_far >= 0) {
-            temp = MAF_Distance(x1, y1, x1 + t_near * dx, y1 + t_near * dy);
-            if (temp < box_collision_dist) {
-                box_collision = gui->blocks[i];
-                box_collision_dist = temp;
-                x2 = x1 + t_near * dx;
-                y2 = y1 + t_near * dy;
-            }
+    // Set cells are drawn like opaque blocks, the rest is see-through
+    Uint32 *pixels = malloc((size_t)mask->width * mask->height * sizeof(Uint32));
+    SDL_Color solid = { 30, 30, 30, 255 };
+
+    for (int cy = 0; cy < mask->height; cy++) {
+        for (int cx = 0; cx < mask->width; cx++) {
+            bool set = (mask->bits[cy * mask->pitch + (cx >> 6)] >> (cx & 63)) & 1;
+            SDL_Color color = set ? solid : (SDL_Color){ 0, 0, 0, 0 };
+            memcpy(&pixels[cy * mask->width + cx], &color, sizeof(Uint32));
         }
     }
 
-    if (box_collision != NULL && count > 1) {
-        // Bottom side collision
-        if (fabs(y2 - (box_collision->y + box_collision->h)) < epsilon) {
-            new_dy = -dy;
-            new_dx = dx;
-        }
-        // Top side collision
-        else if (fabs(y2 - box_collision->y) < epsilon) {
-            new_dy = -dy;
-            new_dx = dx;
-        }
-        // Left side collision
-        else if (fabs(x2 - box_collision->x) < epsilon) {
-            new_dx = -dx;
-            new_dy = dy;
-        }
-        // Right side collision
-        else if (fabs(x2 - (box_collision->x + box_collision->w)) < epsilon) {
-            new_dx = -dx;
-            new_dy = dy;
-        }
+    gui->mask_texture = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, mask->width, mask->height);
+    if (gui->mask_texture != NULL) {
+        SDL_UpdateTexture(gui->mask_texture, NULL, pixels, mask->width * sizeof(Uint32));
+        SDL_SetTextureBlendMode(gui->mask_texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(gui->mask_texture, SDL_SCALEMODE_NEAREST);
     }
 
-    // If no box collisions, extend to the end of the window
-    if (box_collision == NULL) {
-        for (x2 = x1, y2 = y1; x2 >= 0 && x2 <= max_width && y2 >= 0 && y2 <= max_height; x2 += dx, y2 += dy);
+    free(pixels);
+}
 
-        // Fix out of bounds values
-        if (x2 < 0) x2 = 0;
-        if (x2 > WINDOW_WIDTH) x2 = WINDOW_WIDTH;
-        if (y2 < 0) y2 = 0;
-        if (y2 > WINDOW_HEIGHT) y2 = WINDOW_HEIGHT;
+void GRFX_Enable_SDF(struct GRFX_GUI *gui, int num_threads) {
+    if (gui->workers == NULL) gui->workers = GRFX_Create_Workers(num_threads);
 
-        if (x2 <= 0 || x2 >= WINDOW_WIDTH) {
-            new_dx = -dx;
-        }
+    // The cached field of an unchanged scene is mapped instead of built
+    if (gui->cache_path[0] != 0) {
+        GRFX_Open_Cache(&gui->scene, gui->cache_path, SDF_CELL, gui->workers);
+    } else {
+        GRFX_Build_SDF(&gui->scene, SDF_CELL, gui->workers);
+    }
+}
+
+void GRFX_Enable_GI(struct GRFX_GUI *gui, int num_threads) {
+    if (gui->scene.sdf.dist == NULL) GRFX_Enable_SDF(gui, num_threads);
+    gui->gi_enabled = true;
+}
+
+void GRFX_Invalidate(struct GRFX_GUI *gui, const SDL_FRect *region) {
+    GRFX_Invalidate_SDF(&gui->scene, region);
+    GRFX_Invalidate_GI(&gui->gi, region);
+
+    // Any occluder can be on a cached path, the next light drag bakes them again
+    GRFX_Destroy_Light_Cache(&gui->light_cache);
+}
+
+void GRFX_Upload_GI(struct GRFX_GUI *gui) {
+    const struct GRFX_GI_Cascade *probes = &gui->gi.cascades[0];
+    int count = probes->width * probes->height;
+
+    // One texel per cascade 0 probe, filtered up to the window
+    if (gui->gi_texture == NULL || gui->gi_texture->w != probes->width || gui->gi_texture->h != probes->height) {
+        SDL_DestroyTexture(gui->gi_texture);
+        gui->gi_texture = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, probes->width, probes->height);
+        if (gui->gi_texture == NULL) return;
 
-        if (y2 <= 0 || y2 >= WINDOW_HEIGHT) {
-            new_dy = -dy;
+        SDL_SetTextureBlendMode(gui->gi_texture, SDL_BLENDMODE_ADD);
+        SDL_SetTextureScaleMode(gui->gi_texture, SDL_SCALEMODE_LINEAR);
+    }
+
+    SDL_Color *pixels = GRFX_Arena_Alloc(&gui->frame, count * sizeof(SDL_Color));
+
+    for (int i = 0; i < count; i++) {
+        float v = 1 - expf(-gui->gi.fluence[i] * GI_EXPOSURE);
+        pixels[i] = (SDL_Color){ (Uint8)(255 * v), (Uint8)(225 * v), (Uint8)(180 * v), 255 };
+    }
+
+    SDL_UpdateTexture(gui->gi_texture, NULL, pixels, probes->width * sizeof(SDL_Color));
+    GRFX_STAT_ADD(bytes_uploaded, count * sizeof(SDL_Color));
+}
+
+void GRFX_Enable_Ring(struct GRFX_GUI *gui, const char *name) {
+    const SDL_DisplayMode *mode = SDL_GetDesktopDisplayMode(SDL_GetDisplayForWindow(gui->window));
+    int width = gui->camera.width, height = gui->camera.height;
+    bool publishing = gui->slot != NULL;
+    char copy[sizeof(gui->ring.name)];
+
+    // Slots fit a full ray pool and a frame as big as the window's display in pixels, so resizing the window keeps the ring
+    if (mode != NULL) {
+        width = SDL_max(width, (int)(mode->w * mode->pixel_density));
+        height = SDL_max(height, (int)(mode->h * mode->pixel_density));
+    }
+
+    // name can be the old ring's own
+    SDL_strlcpy(copy, name, sizeof(copy));
+    GRFX_Ring_Close(&gui->ring);
+    gui->last_slot = NULL;
+    gui->slot = NULL;
+
+    if (!GRFX_Ring_Create(&gui->ring, copy, RING_SLOTS, RAY_POOL_SIZE, width, height)) {
+        printf("Could not publish to %s: %s\n", copy, SDL_GetError());
+        return;
+    }
+
+    // Replaced in the middle of a frame, which goes into the new ring
+    if (publishing) gui->slot = GRFX_Ring_Begin(&gui->ring);
+}
+
+void GRFX_Publish_Frame(struct GRFX_GUI *gui, SDL_Surface *surface) {
+    struct GRFX_Ring_Slot *slot = gui->slot;
+    const struct GRFX_Ring_Header *header = gui->ring.header;
+
+    // A traced frame always has segments. The others show the same light, so they carry the last traced ones again.
+    if (slot->num_segments == 0 && gui->last_slot != NULL) {
+        slot->num_segments = gui->last_slot->num_segments;
+        memcpy(GRFX_Ring_Segments(slot), GRFX_Ring_Segments(gui->last_slot), slot->num_segments * sizeof(struct GRFX_Ray_Segment));
+    }
+
+    // The image keeps the renderer's format when it has 4 byte pixels, so it is a plain copy of rows; readers
+    // look at the slot's format. It is cropped to the size the ring was made for.
+    if (surface != NULL) {
+        slot->width = SDL_min((Uint32)surface->w, header->max_width);
+        slot->height = SDL_min((Uint32)surface->h, header->max_height);
+        slot->pitch = slot->width * 4;
+        slot->format = SDL_BYTESPERPIXEL(surface->format) == 4 ? surface->format : SDL_PIXELFORMAT_RGBA32;
+
+        if (!SDL_ConvertPixels(slot->width, slot->height, surface->format, surface->pixels, surface->pitch, slot->format, GRFX_Ring_Pixels(&gui->ring, slot), slot->pitch)) {
+            slot->width = slot->height = slot->pitch = 0;
         }
     }
 
-    SDL_RenderLine(gui->renderer, x1, y1, x2, y2);
+    GRFX_Ring_End(&gui->ring, slot);
+    gui->last_slot = slot;
+    gui->slot = NULL;
+}
+
+void GRFX_Draw_GI(struct GRFX_GUI *gui) {
+    const struct GRFX_GI *gi = &gui->gi;
+
+    if (gui->gi_texture == NULL) return;
 
-    GRFX_Render_Ray(gui, x2, y2, new_dx, new_dy, box_collision, count - 1);
+    const struct GRFX_GI_Cascade *probes = &gi->cascades[0];
+    SDL_FPoint corner = GRFX_To_Screen(&gui->camera, gi->domain.x, gi->domain.y);
+    float scale = probes->spacing * gui->camera.zoom;
+    SDL_FRect rect = { corner.x, corner.y, probes->width * scale, probes->height * scale };
+
+    SDL_RenderTexture(gui->renderer, gui->gi_texture, NULL, &rect);
+    GRFX_STAT_ADD(draw_calls, 1);
 }
 
-#pragma endregion GRFX Def
+void GRFX_Upload_Heatmap(struct GRFX_GUI *gui) {
+    const struct GRFX_Heatmap *heatmap = &gui->heatmap;
+    int count = heatmap->width * heatmap->height;
+
+    // One texel per cell, kept blocky so cell edges show
+    if (gui->heatmap_texture == NULL) {
+        gui->heatmap_texture = SDL_CreateTexture(gui->renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, heatmap->width, heatmap->height);
+        if (gui->heatmap_texture == NULL) return;
+
+        SDL_SetTextureBlendMode(gui->heatmap_texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(gui->heatmap_texture, SDL_SCALEMODE_NEAREST);
+    }
+
+    SDL_Color *pixels = GRFX_Arena_Alloc(&gui->frame, count * sizeof(SDL_Color));
+    GRFX_Heatmap_Colors(heatmap, pixels);
+
+    SDL_UpdateTexture(gui->heatmap_texture, NULL, pixels, heatmap->width * sizeof(SDL_Color));
+    GRFX_STAT_ADD(bytes_uploaded, count * sizeof(SDL_Color));
+}
+
+void GRFX_Draw_Heatmap(struct GRFX_GUI *gui) {
+    const struct GRFX_Heatmap *heatmap = &gui->heatmap;
+
+    if (gui->heatmap_texture == NULL) return;
 
-#pragma region MAF Def
+    SDL_FRect rect = { 0, 0, (float)heatmap->width * heatmap->cell, (float)heatmap->height * heatmap->cell };
+    SDL_RenderTexture(gui->renderer, gui->heatmap_texture, NULL, &rect);
+    GRFX_STAT_ADD(draw_calls, 1);
+}
+
+void GRFX_Clear_GUI(struct GRFX_GUI *gui) {
+    SDL_SetRenderDrawColor(gui->renderer, 0, 0, 0, 0);
+    SDL_RenderClear(gui->renderer);
+}
+
+void GRFX_Draw_Circle(SDL_Renderer *renderer, int c_x, int c_y, int r) {
+    for (int y = -r; y <= r; y++) {
+        int dx = (int)sqrt(r * r - y * y);
+        for (int x = -dx; x <= dx; x++) {
+            SDL_RenderPoint(renderer, c_x + x, c_y + y);
+            GRFX_STAT_ADD(draw_calls, 1);
+            GRFX_STAT_ADD(bytes_uploaded, sizeof(SDL_FPoint));
+        }
+    }
+}
+
+void GRFX_Draw_Occluders(struct GRFX_GUI *gui) {
+    struct GRFX_Scene *scene = &gui->scene;
+    struct GRFX_Segments *segs = &scene->segments;
+    struct GRFX_Polygons *polys = &scene->polygons;
+    struct GRFX_Camera *camera = &gui->camera;
+    SDL_FRect view = GRFX_View_Rect(camera);
+    SDL_FRect rect;
+
+    // The mask is one texture, the renderer clips it to the window
+    if (gui->mask_texture != NULL) {
+        const struct GRFX_Mask *mask = &scene->mask;
+        SDL_FPoint corner = GRFX_To_Screen(camera, mask->x, mask->y);
+
+        rect = (SDL_FRect){ corner.x, corner.y, mask->width * mask->cell * camera->zoom, mask->height * mask->cell * camera->zoom };
+        SDL_RenderTexture(gui->renderer, gui->mask_texture, NULL, &rect);
+        GRFX_STAT_ADD(draw_calls, 1);
+    }
+
+    // Opaque blocks first, then glass blocks over them. Anything outside the view is skipped.
+    for (int glass = 0; glass < 2; glass++) {
+        if (glass) SDL_SetRenderDrawColor(gui->renderer, 120, 170, 200, 60);
+        else SDL_SetRenderDrawColor(gui->renderer, 30, 30, 30, 255);
+
+        for(int i = 0; i < scene->num_blocks; i++) {
+            if ((scene->block_ior[i] > 0) != glass) continue;
+
+            if (!SDL_GetRectIntersectionFloat(&scene->blocks[i], &view, &rect)) {
+                GRFX_STAT_ADD(culled, 1);
+                continue;
+            }
+
+            SDL_FPoint corner = GRFX_To_Screen(camera, rect.x, rect.y);
+            rect = (SDL_FRect){ corner.x, corner.y, rect.w * camera->zoom, rect.h * camera->zoom };
+            SDL_RenderFillRect(gui->renderer, &rect);
+            GRFX_STAT_ADD(draw_calls, 1);
+            GRFX_STAT_ADD(bytes_uploaded, sizeof(SDL_FRect));
+        }
+    }
+
+    SDL_SetRenderDrawColor(gui->renderer, 30, 30, 30, 255);
+    for (int i = 0; i < scene->circles.count; i++) {
+        float r = scene->circles.r[i];
+        rect = (SDL_FRect){ scene->circles.x[i] - r, scene->circles.y[i] - r, 2 * r, 2 * r };
+
+        if (!SDL_HasRectIntersectionFloat(&rect, &view)) {
+            GRFX_STAT_ADD(culled, 1);
+            continue;
+        }
+
+        SDL_FPoint center = GRFX_To_Screen(camera, scene->circles.x[i], scene->circles.y[i]);
+        GRFX_Draw_Circle(gui->renderer, center.x, center.y, r * camera->zoom);
+    }
+
+    // Fill polygons as triangle fans
+    SDL_FColor color = { 30 / 255.0f, 30 / 255.0f, 30 / 255.0f, 1.0f };
+    for (int p = 0; p < polys->num; p++) {
+        int first = polys->first[p];
+        float x_min = INFINITY, y_min = INFINITY, x_max = -INFINITY, y_max = -INFINITY;
+
+        for (int i = first; i < first + polys->count[p]; i++) {
+            x_min = fminf(x_min, segs->x1[i]);
+            y_min = fminf(y_min, segs->y1[i]);
+            x_max = fmaxf(x_max, segs->x1[i]);
+            y_max = fmaxf(y_max, segs->y1[i]);
+        }
+
+        rect = (SDL_FRect){ x_min, y_min, x_max - x_min, y_max - y_min };
+        if (!SDL_HasRectIntersectionFloat(&rect, &view)) {
+            GRFX_STAT_ADD(culled, 1);
+            continue;
+        }
+
+        SDL_FPoint a = GRFX_To_Screen(camera, segs->x1[first], segs->y1[first]);
+        for (int i = 1; i < polys->count[p] - 1; i++) {
+            SDL_FPoint b = GRFX_To_Screen(camera, segs->x1[first + i], segs->y1[first + i]);
+            SDL_FPoint c = GRFX_To_Screen(camera, segs->x1[first + i + 1], segs->y1[first + i + 1]);
+            SDL_Vertex tri[3] = {
+                { a, color, { 0, 0 } },
+                { b, color, { 0, 0 } },
+                { c, color, { 0, 0 } }
+            };
+            SDL_RenderGeometry(gui->renderer, NULL, tri, 3, NULL, 0);
+            GRFX_STAT_ADD(draw_calls, 1);
+            GRFX_STAT_ADD(bytes_uploaded, sizeof(tri));
+        }
+    }
+
+    // Outline walls and polygon edges, clipped to the view
+    SDL_SetRenderDrawColor(gui->renderer, 90, 90, 90, 255);
+    for (int i = 0; i < segs->count; i++) {
+        float x1 = segs->x1[i], y1 = segs->y1[i], x2 = segs->x2[i], y2 = segs->y2[i];
+
+        if (!MAF_Clip_Segment(&view, &x1, &y1, &x2, &y2)) {
+            GRFX_STAT_ADD(culled, 1);
+            continue;
+        }
+
+        SDL_FPoint a = GRFX_To_Screen(camera, x1, y1);
+        SDL_FPoint b = GRFX_To_Screen(camera, x2, y2);
+        SDL_RenderLine(gui->renderer, a.x, a.y, b.x, b.y);
+        GRFX_STAT_ADD(draw_calls, 1);
+        GRFX_STAT_ADD(bytes_uploaded, 2 * sizeof(SDL_FPoint));
+    }
+}
+
+bool GRFX_Render_Rays(struct GRFX_GUI *gui, int num_rays, int depth, bool cached) {
+    gui->rays.rays = GRFX_Arena_Alloc(&gui->frame, RAY_POOL_SIZE * sizeof(struct GRFX_Ray));
+    gui->ray_segments = gui->slot != NULL ? GRFX_Ring_Segments(gui->slot) : GRFX_Arena_Alloc(&gui->frame, RAY_POOL_SIZE * sizeof(struct GRFX_Ray_Segment));
+
+    int n = cached ? GRFX_Lookup_Light_Cache(&gui->light_cache, gui->ray_queries[0].x, gui->ray_queries[0].y, gui->ray_segments, RAY_POOL_SIZE) : -1;
+    cached = n >= 0;
+    if (!cached) n = GRFX_Trace_Rays(&gui->scene, &gui->rays, gui->ray_queries, num_rays, depth, gui->ray_segments, RAY_POOL_SIZE);
+    if (gui->slot != NULL) gui->slot->num_segments = n;
+    SDL_FRect view = GRFX_View_Rect(&gui->camera);
+
+    // The light layer can be smaller than the window
+    float scale_x = (float)gui->light_width / gui->camera.width, scale_y = (float)gui->light_height / gui->camera.height;
+
+    if (gui->light_pixels != NULL) GRFX_Raster_Begin(&gui->raster);
+    if (gui->heatmap_enabled) GRFX_Heatmap_Begin(&gui->heatmap);
+
+    for (int i = 0; i < n; i++) {
+        struct GRFX_Ray_Segment *seg = &gui->ray_segments[i];
+        SDL_Color color = gui->ray_colors[seg->ray];
+        float x1 = seg->x1, y1 = seg->y1, x2 = seg->x2, y2 = seg->y2;
+
+        // Rays keep bouncing off screen, only the visible part of each segment is drawn
+        if (!MAF_Clip_Segment(&view, &x1, &y1, &x2, &y2)) {
+            GRFX_STAT_ADD(culled, 1);
+            continue;
+        }
+
+        SDL_FPoint a = GRFX_To_Screen(&gui->camera, x1, y1);
+        SDL_FPoint b = GRFX_To_Screen(&gui->camera, x2, y2);
+
+        if (gui->heatmap_enabled) GRFX_Heatmap_Add(&gui->heatmap, a.x, a.y, b.x, b.y, seg->cost);
+
+        a.x *= scale_x, a.y *= scale_y;
+        b.x *= scale_x, b.y *= scale_y;
+
+        // The rasterizer takes the lines now and draws them all at once below
+        if (gui->light_pixels != NULL) {
+            color.a *= seg->energy;
+            GRFX_Raster_Add_Line(&gui->raster, a.x, a.y, b.x, b.y, color);
+            continue;
+        }
+
+        SDL_SetRenderDrawColor(gui->renderer, color.r, color.g, color.b, color.a * seg->energy);
+        SDL_RenderLine(gui->renderer, a.x, a.y, b.x, b.y);
+        GRFX_STAT_ADD(draw_calls, 1);
+        GRFX_STAT_ADD(bytes_uploaded, 2 * sizeof(SDL_FPoint));
+    }
+
+    // Tiles are drawn in parallel, then the whole framebuffer goes up as one texture
+    if (gui->light_pixels != NULL) {
+        GRFX_Raster_Draw(&gui->raster, gui->workers);
+        if (gui->bloom_enabled) GRFX_Apply_Bloom(&gui->bloom, gui->raster.pixels, gui->raster.pitch, gui->workers);
+        SDL_UpdateTexture(gui->light_pixels, NULL, gui->raster.pixels, gui->raster.pitch);
+        GRFX_STAT_ADD(draw_calls, 1);
+        GRFX_STAT_ADD(bytes_uploaded, gui->raster.pitch * gui->raster.height);
+    }
+
+    if (gui->heatmap_enabled) GRFX_Upload_Heatmap(gui);
+
+    return cached;
+}
+
+void GRFX_Accumulate(struct GRFX_GUI *gui, int n) {
+    // Running average: accum = accum * (1 - 1/(n+1)) + layer * 1/(n+1), the first frame replaces it
+    SDL_SetRenderTarget(gui->renderer, gui->accum);
+    SDL_Texture *layer = gui->light_pixels != NULL ? gui->light_pixels : gui->light_layer;
+
+    SDL_SetTextureAlphaModFloat(layer, 1.0f / (n + 1));
+    SDL_RenderTexture(gui->renderer, layer, NULL, NULL);
+    GRFX_STAT_ADD(draw_calls, 1);
+    SDL_SetRenderTarget(gui->renderer, NULL);
+}
+
+#pragma endregion GRFX Def
+
+#pragma region Capture Def
+
+void GRFX_Parse_Args(int argc, char *argv[], struct GRFX_Options *options) {
+    options->config = (struct GRFX_Config){ WINDOW_WIDTH, WINDOW_HEIGHT, NUM_BLOCKS, NUM_LIGHT_RAYS, NUM_RAY_REFLECTIONS, RAY_OPACITY, RENDER_SCALE };
+    options->stats_path = NULL;
+    options->capture_dir = NULL;
+    options->capture_format = CAPTURE_FORMAT_BMP;
+    options->capture_policy = CAPTURE_DROP;
+    options->moving_blocks = 0;
+    options->raster = false;
+    options->bloom = false;
+    options->sdf = false;
+    options->gi = false;
+    options->heatmap = false;
+    options->light_cache = false;
+    options->power = false;
+    options->bench_frames = 0;
+    options->tile_dir = NULL;
+    options->mask_path = NULL;
+    options->scene_path = NULL;
+    options->cache = false;
+    options->ring_name = NULL;
+    options->batch_list = NULL;
+    options->batch_out = NULL;
+    options->batch_rays = BATCH_RAYS;
+    options->batch_depth = BATCH_DEPTH;
+    options->threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            options->stats_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            options->capture_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "bmp") == 0) options->capture_format = CAPTURE_FORMAT_BMP;
+            else if (strcmp(argv[i], "raw") == 0) options->capture_format = CAPTURE_FORMAT_RAW;
+            else {
+                printf("Unknown capture format: %s (expected bmp or raw)\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--capture-policy") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "drop") == 0) options->capture_policy = CAPTURE_DROP;
+            else if (strcmp(argv[i], "block") == 0) options->capture_policy = CAPTURE_BLOCK;
+            else {
+                printf("Unknown capture policy: %s (expected drop or block)\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--moving") == 0 && i + 1 < argc) {
+            options->moving_blocks = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            options->bench_frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--raster") == 0) {
+            options->raster = true;
+        }
+        else if (strcmp(argv[i], "--bloom") == 0) {
+            options->bloom = true;
+        }
+        else if (strcmp(argv[i], "--sdf") == 0) {
+            options->sdf = true;
+        }
+        else if (strcmp(argv[i], "--gi") == 0) {
+            options->gi = true;
+        }
+        else if (strcmp(argv[i], "--heatmap") == 0) {
+            options->heatmap = true;
+        }
+        else if (strcmp(argv[i], "--light-cache") == 0) {
+            options->light_cache = true;
+        }
+        else if (strcmp(argv[i], "--power") == 0) {
+            options->power = true;
+        }
+        else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc) {
+            options->tile_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--mask") == 0 && i + 1 < argc) {
+            options->mask_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            options->scene_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache") == 0) {
+            options->cache = true;
+        }
+        else if (strcmp(argv[i], "--publish") == 0 && i + 1 < argc) {
+            options->ring_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            options->batch_list = argv[++i];
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            options->batch_out = argv[++i];
+        }
+        else if (strcmp(argv[i], "--rays") == 0 && i + 1 < argc) {
+            options->batch_rays = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            options->batch_depth = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options->threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            i++;
+            if (!GRFX_Load_Config(&options->config, argv[i])) {
+                printf("%s\n", SDL_GetError());
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            i++;
+            if (!GRFX_Parse_Size(argv[i], &options->config.window_width, &options->config.window_height)) {
+                printf("Bad window size: %s (expected WxH)\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            options->config.num_blocks = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--light-rays") == 0 && i + 1 < argc) {
+            options->config.num_rays = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--reflections") == 0 && i + 1 < argc) {
+            options->config.num_reflections = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--opacity") == 0 && i + 1 < argc) {
+            options->config.ray_opacity = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+            options->config.render_scale = atof(argv[++i]);
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if (options->batch_list != NULL && options->batch_out == NULL) {
+        printf("--batch needs an --out file\n");
+        exit(1);
+    }
+
+    // Random moving blocks would be part of the hashed scene, so the file would never match and be rewritten every start
+    if (options->cache && options->moving_blocks > 0 && options->batch_list == NULL) {
+        printf("--cache is ignored with --moving\n");
+        options->cache = false;
+    }
+
+    if (options->batch_rays < 1) options->batch_rays = 1;
+    if (options->batch_depth < 1) options->batch_depth = 1;
+
+    // Keep the config in the ranges the frame loop expects
+    struct GRFX_Config *config = &options->config;
+    config->window_width = SDL_clamp(config->window_width, 64, 16384);
+    config->window_height = SDL_clamp(config->window_height, 64, 16384);
+    config->num_blocks = SDL_max(config->num_blocks, 0);
+    config->num_reflections = SDL_clamp(config->num_reflections, 1, MAX_RAY_REFLECTIONS);
+    config->num_rays = SDL_clamp(config->num_rays, 2, RAY_POOL_SIZE / config->num_reflections);
+    config->ray_opacity = SDL_clamp(config->ray_opacity, 0, 255);
+    config->render_scale = SDL_clamp(config->render_scale, MIN_RENDER_SCALE, 1.0f);
+}
+
+bool GRFX_Load_Config(struct GRFX_Config *config, const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[256], key[32];
+    int line_number = 0, used;
+
+    if (file == NULL) return SDL_SetError("Could not open config %s", path);
+
+    // Same layout as scene files: a key, its values, '#' starts a comment
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        if (sscanf(line, " %31s%n", key, &used) != 1 || key[0] == '#') continue;
+
+        const char *args = line + used;
+        int ok;
+
+        if (strcmp(key, "window") == 0) ok = sscanf(args, "%d %d", &config->window_width, &config->window_height) == 2;
+        else if (strcmp(key, "blocks") == 0) ok = sscanf(args, "%d", &config->num_blocks) == 1;
+        else if (strcmp(key, "rays") == 0) ok = sscanf(args, "%d", &config->num_rays) == 1;
+        else if (strcmp(key, "reflections") == 0) ok = sscanf(args, "%d", &config->num_reflections) == 1;
+        else if (strcmp(key, "opacity") == 0) ok = sscanf(args, "%d", &config->ray_opacity) == 1;
+        else if (strcmp(key, "scale") == 0) ok = sscanf(args, "%f", &config->render_scale) == 1;
+        else ok = false;
+
+        if (!ok) {
+            fclose(file);
+            return SDL_SetError("%s:%d: bad config line", path, line_number);
+        }
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+bool GRFX_Parse_Size(const char *text, int *width, int *height) {
+    return sscanf(text, "%dx%d", width, height) == 2;
+}
+
+int GRFX_Capture_Writer(void *data) {
+    struct GRFX_Capture *capture = data;
+    struct GRFX_Capture_Frame *frame;
+    char path[1024];
+
+    while (true) {
+        // Wait for a queued frame, drain the queue before quitting
+        SDL_LockMutex(capture->lock);
+        while (capture->queued == 0 && !capture->quit) {
+            SDL_WaitCondition(capture->cond, capture->lock);
+        }
+
+        if (capture->queued == 0) {
+            SDL_UnlockMutex(capture->lock);
+            break;
+        }
+
+        frame = &capture->frames[capture->queue[capture->queue_head]];
+        capture->queue_head = (capture->queue_head + 1) % CAPTURE_POOL_SIZE;
+        capture->queued--;
+        SDL_UnlockMutex(capture->lock);
+
+        // Encode and write without holding the lock
+        if (capture->format == CAPTURE_FORMAT_BMP) {
+            SDL_snprintf(path, sizeof(path), "%s/frame_%06d.bmp", capture->dir, frame->number);
+            SDL_Surface *surface = SDL_CreateSurfaceFrom(frame->w, frame->h, frame->format, frame->pixels, frame->pitch);
+
+            if (surface == NULL || !SDL_SaveBMP(surface, path)) {
+                printf("Capture Error: %s\n", SDL_GetError());
+            }
+
+            SDL_DestroySurface(surface);
+        } else {
+            SDL_snprintf(path, sizeof(path), "%s/frame_%06d_%dx%d_%s.raw", capture->dir, frame->number, frame->w, frame->h, SDL_GetPixelFormatName(frame->format));
+            SDL_IOStream *io = SDL_IOFromFile(path, "wb");
+
+            if (io == NULL || SDL_WriteIO(io, frame->pixels, (size_t)frame->pitch * frame->h) != (size_t)frame->pitch * frame->h) {
+                printf("Capture Error: %s\n", SDL_GetError());
+            }
+
+            SDL_CloseIO(io);
+        }
+
+        // Hand the buffer back to the pool
+        SDL_LockMutex(capture->lock);
+        capture->free_list[capture->num_free++] = frame - capture->frames;
+        capture->written++;
+        SDL_SignalCondition(capture->cond);
+        SDL_UnlockMutex(capture->lock);
+    }
+
+    return 0;
+}
+
+void GRFX_Capture_Start(struct GRFX_Capture *capture, const struct GRFX_Options *options) {
+    memset(capture, 0, sizeof(*capture));
+
+    capture->dir = options->capture_dir;
+    capture->format = options->capture_format;
+    capture->policy = options->capture_policy;
+    capture->enabled = options->capture_dir != NULL;
+
+    if (!capture->enabled) return;
+
+    if (!SDL_CreateDirectory(capture->dir)) {
+        printf("SDL_CreateDirectory Error: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    for (int i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        capture->free_list[i] = i;
+    }
+    capture->num_free = CAPTURE_POOL_SIZE;
+
+    capture->lock = SDL_CreateMutex();
+    capture->cond = SDL_CreateCondition();
+    capture->thread = SDL_CreateThread(GRFX_Capture_Writer, "capture", capture);
+
+    if (capture->lock == NULL || capture->cond == NULL || capture->thread == NULL) {
+        printf("Capture Error: %s\n", SDL_GetError());
+        exit(1);
+    }
+}
+
+void GRFX_Capture_Frame(struct GRFX_Capture *capture, SDL_Surface *surface) {
+    struct GRFX_Capture_Frame *frame;
+
+    if (!capture->enabled || capture->paused) return;
+
+    if (surface == NULL) {
+        printf("SDL_RenderReadPixels Error: %s\n", SDL_GetError());
+        return;
+    }
+
+    // Take a free buffer, or drop / wait according to the policy
+    SDL_LockMutex(capture->lock);
+    if (capture->num_free == 0 && capture->policy == CAPTURE_DROP) {
+        capture->dropped++;
+        capture->number++;
+        SDL_UnlockMutex(capture->lock);
+        return;
+    }
+
+    while (capture->num_free == 0) {
+        SDL_WaitCondition(capture->cond, capture->lock);
+    }
+
+    frame = &capture->frames[capture->free_list[--capture->num_free]];
+    SDL_UnlockMutex(capture->lock);
+
+    // Buffers are reused, only grown when the frame gets bigger
+    size_t size = (size_t)surface->pitch * surface->h;
+    if (size > frame->size) {
+        free(frame->pixels);
+        frame->pixels = malloc(size);
+        frame->size = size;
+    }
+
+    memcpy(frame->pixels, surface->pixels, size);
+    frame->w = surface->w;
+    frame->h = surface->h;
+    frame->pitch = surface->pitch;
+    frame->format = surface->format;
+    frame->number = capture->number++;
+
+    // Queue it for the writer
+    SDL_LockMutex(capture->lock);
+    capture->queue[(capture->queue_head + capture->queued) % CAPTURE_POOL_SIZE] = frame - capture->frames;
+    capture->queued++;
+    SDL_SignalCondition(capture->cond);
+    SDL_UnlockMutex(capture->lock);
+}
+
+void GRFX_Capture_End(struct GRFX_Capture *capture) {
+    if (!capture->enabled) return;
+
+    SDL_LockMutex(capture->lock);
+    capture->quit = true;
+    SDL_SignalCondition(capture->cond);
+    SDL_UnlockMutex(capture->lock);
+
+    SDL_WaitThread(capture->thread, NULL);
+    SDL_DestroyCondition(capture->cond);
+    SDL_DestroyMutex(capture->lock);
+
+    for (int i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        free(capture->frames[i].pixels);
+    }
+
+    printf("Captured %d frames to %s, dropped %d\n", capture->written, capture->dir, capture->dropped);
+}
+
+#pragma endregion Capture Def
+
+#pragma region Stats Def
+
+void GRFX_Stats_Draw(SDL_Renderer *renderer) {
+    struct GRFX_Stats *frame = &grfx_stats_state.frame;
+    char line[128];
+    float y = 8;
+
+#define STATS_LINE(...) SDL_snprintf(line, sizeof(line), __VA_ARGS__); SDL_RenderDebugText(renderer, 8, y, line); y += 10
+
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    STATS_LINE("frame     %.2f ms", frame->frame_ns / 1e6);
+    STATS_LINE("rays      %llu", (unsigned long long)frame->rays);
+    STATS_LINE("bounces   %llu", (unsigned long long)frame->bounces);
+    STATS_LINE("slabs     %llu", (unsigned long long)frame->slab_tests);
+    STATS_LINE("bvh       %llu nodes %llu refit %llu rebuild", (unsigned long long)frame->node_tests, (unsigned long long)frame->bvh_refits, (unsigned long long)frame->bvh_rebuilds);
+    STATS_LINE("seg/circ  %llu / %llu", (unsigned long long)frame->segment_tests, (unsigned long long)frame->circle_tests);
+    STATS_LINE("hits      %llu blk %llu seg %llu circ %llu wall", (unsigned long long)frame->block_hits, (unsigned long long)frame->segment_hits, (unsigned long long)frame->circle_hits, (unsigned long long)frame->wall_hits);
+    STATS_LINE("segments  %llu", (unsigned long long)frame->segments);
+    STATS_LINE("draws     %llu", (unsigned long long)frame->draw_calls);
+    STATS_LINE("bytes     %llu", (unsigned long long)frame->bytes_uploaded);
+    STATS_LINE("culled    %llu", (unsigned long long)frame->culled);
+    STATS_LINE("allocs    %llu", (unsigned long long)frame->allocations);
+    STATS_LINE("power     level %llu", (unsigned long long)frame->power_level);
+
+#undef STATS_LINE
+}
+
+#pragma endregion Stats Def
+
+#pragma region Bench Def
+
+void GRFX_Bench_Start(struct GRFX_Bench *bench, int n) {
+    bench->frames = n > 0 ? n : 0;
+    bench->frame = 0;
+    bench->times = NULL;
+    bench->allocations = NULL;
+
+    if (bench->frames == 0) return;
+
+    bench->times = malloc(bench->frames * sizeof(Uint64));
+    bench->allocations = malloc(bench->frames * sizeof(Uint64));
+}
+
+void GRFX_Bench_Frame(struct GRFX_Bench *bench) {
+    if (bench->frame >= bench->frames) return;
+
+    bench->times[bench->frame] = grfx_stats_state.frame.frame_ns;
+    bench->allocations[bench->frame] = grfx_stats_state.frame.allocations;
+    bench->frame++;
+}
+
+int GRFX_Compare_Uint64(const void *a, const void *b) {
+    Uint64 x = *(const Uint64 *)a, y = *(const Uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+int GRFX_Bench_End(struct GRFX_Bench *bench) {
+    int allocating = 0, first = -1;
+
+    if (bench->frames == 0) return 0;
+
+    // Frames after warmup should never touch the heap
+    for (int i = BENCH_WARMUP; i < bench->frame; i++) {
+        if (bench->allocations[i] == 0) continue;
+        if (first < 0) first = i;
+        allocating++;
+    }
+
+    qsort(bench->times, bench->frame, sizeof(Uint64), GRFX_Compare_Uint64);
+
+    if (bench->frame > 0) {
+        printf("Bench: %d frames, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", bench->frame,
+            bench->times[bench->frame / 2] / 1e6, bench->times[bench->frame * 99 / 100] / 1e6, bench->times[bench->frame - 1] / 1e6);
+    }
+
+    if (allocating > 0) {
+        printf("Bench FAILED: %d frames after warmup allocated, first was frame %d with %llu allocations\n", allocating, first, (unsigned long long)bench->allocations[first]);
+    }
+
+    free(bench->times);
+    free(bench->allocations);
+
+    return allocating > 0 ? 1 : 0;
+}
+
+#pragma endregion Bench Def
+
+#pragma region Power Def
+
+void GRFX_Power_Start(struct GRFX_Power *power, const struct GRFX_Options *options, const struct GRFX_GUI *gui) {
+    memset(power, 0, sizeof(*power));
+
+    // Benchmarks run at full quality whatever powers them
+    power->enabled = options->power && options->bench_frames == 0;
+    power->state = SDL_POWERSTATE_UNKNOWN;
+    power->bloom = gui->bloom_enabled;
+    power->gi = gui->gi_enabled;
+}
+
+bool GRFX_Power_Update(struct GRFX_Power *power, struct GRFX_GUI *gui, Uint64 frame_ns) {
+    Uint64 now = SDL_GetTicks();
+
+    if (!power->enabled) return false;
+
+    GRFX_STAT_ADD(power_level, power->level);
+
+    // Smoothed cost of the frames that traced, idle frames say nothing about it
+    if (frame_ns > 0) power->frame_ms += (frame_ns / 1e6f - power->frame_ms) * 0.1f;
+
+    // Asking the system is slow on some platforms, so it is only done every few seconds
+    if (now < power->next_check) return false;
+    power->next_check = now + POWER_CHECK_MS;
+
+    int percent = -1;
+    SDL_PowerState state = SDL_GetPowerInfo(NULL, &percent);
+    bool battery = state == SDL_POWERSTATE_ON_BATTERY;
+    bool low = battery && percent >= 0 && percent <= POWER_LOW_PERCENT;
+    int level = battery ? (low ? 2 : 1) : 0;
+
+    // Still on battery and tracing eats most of the frame: one level lower, which only a change of supply undoes
+    if (battery && state == power->state && level <= power->level) {
+        level = power->level;
+        if (power->frame_ms > POWER_BUSY * (16 << level)) level++;
+    }
+
+    level = SDL_min(level, POWER_MAX_LEVEL);
+    power->state = state;
+
+    if (level == power->level) return false;
+
+    power->level = level;
+    gui->bloom_enabled = power->bloom && level == 0;
+    gui->gi_enabled = power->gi && level == 0;
+    GRFX_STAT_ADD(power_changes, 1);
+
+    printf("Power: %s, %d%% charge, %.1f ms per frame: level %d\n", battery ? "on battery" : "plugged in", percent, power->frame_ms, level);
+
+    // Frames at the new level cost something else
+    power->frame_ms = 0;
+
+    return true;
+}
+
+int GRFX_Power_Rays(const struct GRFX_Power *power, int num_rays) {
+    return SDL_max(num_rays >> power->level, 2);
+}
+
+int GRFX_Power_Reflections(const struct GRFX_Power *power, int num_reflections) {
+    return SDL_max(num_reflections - power->level, 1);
+}
+
+#pragma endregion Power Def
+
+#pragma region Stream Def
+
+void GRFX_Stream_Start(struct GRFX_Streamer *streamer, const struct GRFX_Options *options) {
+    memset(streamer, 0, sizeof(*streamer));
+    streamer->dir = options->tile_dir;
+    streamer->enabled = options->tile_dir != NULL;
+
+    if (!streamer->enabled) return;
+
+    for (int i = 0; i < TILE_BUDGET; i++) {
+        streamer->tiles[i].scene = GRFX_Create_Scene(WORLD_WIDTH, WORLD_HEIGHT);
+    }
+
+    streamer->lock = SDL_CreateMutex();
+    streamer->cond = SDL_CreateCondition();
+    streamer->thread = SDL_CreateThread(GRFX_Stream_Loader, "tile loader", streamer);
+
+    if (streamer->thread == NULL) {
+        printf("Stream Error: %s\n", SDL_GetError());
+        streamer->enabled = false;
+    }
+}
+
+int GRFX_Stream_Loader(void *data) {
+    struct GRFX_Streamer *streamer = data;
+    char path[1024];
+
+    SDL_LockMutex(streamer->lock);
+    while (!streamer->quit) {
+        struct GRFX_Tile *tile = NULL;
+
+        for (int i = 0; i < TILE_BUDGET && tile == NULL; i++) {
+            if (streamer->tiles[i].state == TILE_QUEUED) tile = &streamer->tiles[i];
+        }
+
+        if (tile == NULL) {
+            SDL_WaitCondition(streamer->cond, streamer->lock);
+            continue;
+        }
+
+        // A loading tile is never evicted, so its scene can be filled without the lock
+        tile->state = TILE_LOADING;
+        SDL_snprintf(path, sizeof(path), "%s/tile_%d_%d.scene", streamer->dir, tile->tx, tile->ty);
+        SDL_UnlockMutex(streamer->lock);
+
+        // A missing file is an empty tile
+        if (!GRFX_Load_Scene(&tile->scene, path)) GRFX_Clear_Scene(&tile->scene);
+
+        SDL_LockMutex(streamer->lock);
+        tile->state = TILE_READY;
+        streamer->loaded++;
+        if (tile->scene.num_blocks || tile->scene.segments.count || tile->scene.circles.count) streamer->changed = true;
+    }
+    SDL_UnlockMutex(streamer->lock);
+
+    return 0;
+}
+
+bool GRFX_Stream_Update(struct GRFX_Streamer *streamer, SDL_FRect view, float light_x, float light_y) {
+    int tiles_x = (WORLD_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (WORLD_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+    int light_tx = light_x / TILE_SIZE, light_ty = light_y / TILE_SIZE;
+    bool changed;
+
+    if (!streamer->enabled) return false;
+
+    // Tiles under the view plus a margin, clamped to the world
+    int tx_min = SDL_max((int)floorf(view.x / TILE_SIZE) - TILE_MARGIN, 0);
+    int ty_min = SDL_max((int)floorf(view.y / TILE_SIZE) - TILE_MARGIN, 0);
+    int tx_max = SDL_min((int)floorf((view.x + view.w) / TILE_SIZE) + TILE_MARGIN, tiles_x - 1);
+    int ty_max = SDL_min((int)floorf((view.y + view.h) / TILE_SIZE) + TILE_MARGIN, tiles_y - 1);
+
+    SDL_LockMutex(streamer->lock);
+    streamer->frame++;
+
+    // The light's own tile comes first, rays start there even when it is off screen
+    for (int k = -1; k <= (tx_max - tx_min + 1) * (ty_max - ty_min + 1) - 1; k++) {
+        int tx = k < 0 ? light_tx : tx_min + k % (tx_max - tx_min + 1);
+        int ty = k < 0 ? light_ty : ty_min + k / (tx_max - tx_min + 1);
+        struct GRFX_Tile *victim = NULL;
+        int resident = false;
+
+        if (tx < 0 || ty < 0 || tx >= tiles_x || ty >= tiles_y) continue;
+
+        for (int i = 0; i < TILE_BUDGET; i++) {
+            struct GRFX_Tile *tile = &streamer->tiles[i];
+
+            if (tile->state != TILE_EMPTY && tile->tx == tx && tile->ty == ty) {
+                tile->last_used = streamer->frame;
+                resident = true;
+                break;
+            }
+
+            // Free slots first, then the least recently used tile not wanted this frame
+            if (tile->state == TILE_LOADING || tile->last_used == streamer->frame) continue;
+            if (victim == NULL || (victim->state != TILE_EMPTY && (tile->state == TILE_EMPTY || tile->last_used < victim->last_used))) {
+                victim = tile;
+            }
+        }
+
+        if (resident || victim == NULL) continue;
+
+        if (victim->state == TILE_READY) {
+            streamer->evicted++;
+            streamer->changed = true;
+        }
+
+        victim->tx = tx;
+        victim->ty = ty;
+        victim->state = TILE_QUEUED;
+        victim->last_used = streamer->frame;
+        SDL_SignalCondition(streamer->cond);
+    }
+
+    changed = streamer->changed;
+    streamer->changed = false;
+    SDL_UnlockMutex(streamer->lock);
+
+    return changed;
+}
+
+void GRFX_Stream_Compose(struct GRFX_Streamer *streamer, struct GRFX_Scene *scene, struct GRFX_Scene_Mark base) {
+    GRFX_Reset_Scene(scene, base);
+
+    SDL_LockMutex(streamer->lock);
+    for (int i = 0; i < TILE_BUDGET; i++) {
+        if (streamer->tiles[i].state == TILE_READY) GRFX_Append_Scene(scene, &streamer->tiles[i].scene);
+    }
+    SDL_UnlockMutex(streamer->lock);
+}
+
+void GRFX_Stream_End(struct GRFX_Streamer *streamer) {
+    if (!streamer->enabled) return;
+
+    SDL_LockMutex(streamer->lock);
+    streamer->quit = true;
+    SDL_SignalCondition(streamer->cond);
+    SDL_UnlockMutex(streamer->lock);
+
+    SDL_WaitThread(streamer->thread, NULL);
+    SDL_DestroyCondition(streamer->cond);
+    SDL_DestroyMutex(streamer->lock);
+
+    for (int i = 0; i < TILE_BUDGET; i++) {
+        GRFX_Destroy_Scene(&streamer->tiles[i].scene);
+    }
+}
+
+#pragma endregion Stream Def
+
+#pragma region Batch Def
+
+int GRFX_Batch_Run(const struct GRFX_Options *options) {
+    struct GRFX_Batch *batch = calloc(1, sizeof(struct GRFX_Batch));
+    char line[4096];
+    int path_capacity = 0;
+    FILE *list = fopen(options->batch_list, "r");
+
+    if (list == NULL) {
+        printf("Could not open batch list %s\n", options->batch_list);
+        return 1;
+    }
+
+    // One scene path per line, blank lines and '#' comments are skipped
+    while (fgets(line, sizeof(line), list) != NULL) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == 0 || line[0] == '#') continue;
+
+        if (batch->num_scenes == path_capacity) {
+            path_capacity = path_capacity ? path_capacity * 2 : 64;
+            batch->paths = realloc(batch->paths, path_capacity * sizeof(char *));
+        }
+        batch->paths[batch->num_scenes++] = SDL_strdup(line);
+    }
+    fclose(list);
+
+    batch->out = fopen(options->batch_out, "wb");
+    if (batch->out == NULL) {
+        printf("Could not open batch output %s\n", options->batch_out);
+        return 1;
+    }
+
+    batch->num_rays = options->batch_rays;
+    batch->depth = options->batch_depth;
+    batch->sdf = options->sdf;
+    batch->cache = options->cache;
+    batch->lock = SDL_CreateMutex();
+
+    // Header: magic, then scene count, rays per scene and depth
+    Uint32 header[3] = { batch->num_scenes, batch->num_rays, batch->depth };
+    fwrite(BATCH_MAGIC, 1, 8, batch->out);
+    fwrite(header, sizeof(Uint32), 3, batch->out);
+
+    GRFX_Stats_Init();
+    struct GRFX_Workers *workers = GRFX_Create_Workers(options->threads);
+
+    // Every thread gets its own scratch up front, so tracing never touches the allocator unless a scene outgrows it
+    for (int t = 0; t < workers->num_threads; t++) {
+        struct GRFX_Batch_Scratch *scratch = &batch->scratch[t];
+        scratch->scene = GRFX_Create_Scene(WINDOW_WIDTH, WINDOW_HEIGHT);
+        scratch->capacity = (int)SDL_min((Sint64)batch->num_rays * batch->depth, BATCH_MAX_SEGMENTS);
+        scratch->pool = GRFX_Create_Ray_Pool(scratch->capacity);
+        scratch->queries = malloc(batch->num_rays * sizeof(struct GRFX_Ray_Query));
+        scratch->segments = malloc(scratch->capacity * sizeof(struct GRFX_Ray_Segment));
+    }
+
+    Uint64 start = SDL_GetTicksNS();
+    GRFX_Parallel_For(workers, batch->num_scenes, GRFX_Batch_Scene, batch);
+    Uint64 elapsed = SDL_GetTicksNS() - start;
+
+    printf("Traced %d scenes (%d failed) on %d threads in %.1f ms\n", batch->num_scenes, batch->failed, workers->num_threads, elapsed / 1e6);
+
+    // The whole batch counts as one frame
+    GRFX_Stats_Frame_End(elapsed);
+    if (options->stats_path != NULL) GRFX_Stats_Dump(options->stats_path);
+
+    for (int t = 0; t < workers->num_threads; t++) {
+        struct GRFX_Batch_Scratch *scratch = &batch->scratch[t];
+        GRFX_Destroy_Scene(&scratch->scene);
+        GRFX_Destroy_Ray_Pool(&scratch->pool);
+        free(scratch->queries);
+        free(scratch->segments);
+        free(scratch->block_hits);
+        free(scratch->block_energy);
+        free(scratch->record);
+    }
+
+    GRFX_Destroy_Workers(workers);
+    GRFX_Stats_End();
+    fclose(batch->out);
+    SDL_DestroyMutex(batch->lock);
+
+    int failed = batch->failed;
+    for (int i = 0; i < batch->num_scenes; i++) SDL_free(batch->paths[i]);
+    free(batch->paths);
+    free(batch);
+
+    return failed > 0 ? 1 : 0;
+}
+
+void GRFX_Batch_Scene(void *data, int index, int thread) {
+    struct GRFX_Batch *batch = data;
+    struct GRFX_Batch_Scratch *scratch = &batch->scratch[thread];
+    struct GRFX_Scene *scene = &scratch->scene;
+
+    scene->width = WINDOW_WIDTH;
+    scene->height = WINDOW_HEIGHT;
+
+    // A scene that fails to load still gets a record, empty and marked failed, so the file always holds one per scene
+    if (!GRFX_Load_Scene(scene, batch->paths[index])) {
+        Uint32 head[4] = { index, BATCH_FAILED, 0, 0 };
+
+        SDL_LockMutex(batch->lock);
+        printf("%s\n", SDL_GetError());
+        batch->failed++;
+        fwrite(head, sizeof(Uint32), 4, batch->out);
+        SDL_UnlockMutex(batch->lock);
+        return;
+    }
+
+    // Each worker builds its scene's BVH and field on its own, or maps them from the scene's cache file
+    if (batch->cache) {
+        char cache_path[1024];
+        SDL_snprintf(cache_path, sizeof(cache_path), "%s.cache", batch->paths[index]);
+        GRFX_Open_Cache(scene, cache_path, batch->sdf ? SDF_CELL : 0, NULL);
+    } else {
+        GRFX_Update_BVH(scene);
+        if (batch->sdf) GRFX_Build_SDF(scene, SDF_CELL, NULL);
+    }
+
+    // A full fan of rays from the center of the light
+    for (int i = 0; i < batch->num_rays; i++) {
+        double rad = 2 * M_PI * i / batch->num_rays;
+        scratch->queries[i] = (struct GRFX_Ray_Query){ scene->light_x, scene->light_y, cos(rad), sin(rad) };
+    }
+
+    // Glass splits rays, so a fan can outgrow rays x depth: when the output or the pool filled up, grow both and trace again
+    int n = GRFX_Trace_Rays(scene, &scratch->pool, scratch->queries, batch->num_rays, batch->depth, scratch->segments, scratch->capacity);
+    bool full = n == scratch->capacity || scratch->pool.count == scratch->pool.capacity;
+
+    while (full && scratch->capacity < BATCH_MAX_SEGMENTS) {
+        int capacity = SDL_min(2 * scratch->capacity, BATCH_MAX_SEGMENTS);
+        struct GRFX_Ray_Segment *segments = realloc(scratch->segments, capacity * sizeof(struct GRFX_Ray_Segment));
+        struct GRFX_Ray *rays = realloc(scratch->pool.rays, capacity * sizeof(struct GRFX_Ray));
+
+        if (segments != NULL) scratch->segments = segments;
+        if (rays != NULL) scratch->pool.rays = rays;
+        if (segments == NULL || rays == NULL) break;
+
+        scratch->capacity = scratch->pool.capacity = capacity;
+        n = GRFX_Trace_Rays(scene, &scratch->pool, scratch->queries, batch->num_rays, batch->depth, scratch->segments, scratch->capacity);
+        full = n == scratch->capacity || scratch->pool.count == scratch->pool.capacity;
+    }
+
+    if (full) {
+        SDL_LockMutex(batch->lock);
+        printf("%s: more than %d segments, the record is truncated\n", batch->paths[index], scratch->capacity);
+        SDL_UnlockMutex(batch->lock);
+    }
+
+    if (scene->num_blocks > scratch->block_capacity) {
+        scratch->block_capacity = scene->num_blocks;
+        scratch->block_hits = realloc(scratch->block_hits, scratch->block_capacity * sizeof(Uint32));
+        scratch->block_energy = realloc(scratch->block_energy, scratch->block_capacity * sizeof(float));
+    }
+
+    memset(scratch->block_hits, 0, scene->num_blocks * sizeof(Uint32));
+    memset(scratch->block_energy, 0, scene->num_blocks * sizeof(float));
+
+    Uint32 num_hits = 0;
+    for (int i = 0; i < n; i++) {
+        struct GRFX_Ray_Segment *seg = &scratch->segments[i];
+        if (seg->hit_kind == GRFX_HIT_NONE) continue;
+
+        num_hits++;
+        if (seg->hit_kind == GRFX_HIT_BLOCK) {
+            scratch->block_hits[seg->hit_id]++;
+            scratch->block_energy[seg->hit_id] += seg->energy;
+        }
+    }
+
+    // Record: scene index, status, block and hit counts, then per block (hits, energy) and per hit (x, y, energy, ray, kind, id)
+    Uint32 head[4] = { index, full ? BATCH_TRUNCATED : BATCH_OK, scene->num_blocks, num_hits };
+    scratch->record_size = 0;
+    GRFX_Batch_Put(scratch, head, sizeof(head));
+
+    for (int b = 0; b < scene->num_blocks; b++) {
+        GRFX_Batch_Put(scratch, &scratch->block_hits[b], sizeof(Uint32));
+        GRFX_Batch_Put(scratch, &scratch->block_energy[b], sizeof(float));
+    }
+
+    for (int i = 0; i < n; i++) {
+        struct GRFX_Ray_Segment *seg = &scratch->segments[i];
+        if (seg->hit_kind == GRFX_HIT_NONE) continue;
+
+        float hit[3] = { seg->x2, seg->y2, seg->energy };
+        Sint32 ids[3] = { seg->ray, seg->hit_kind, seg->hit_id };
+        GRFX_Batch_Put(scratch, hit, sizeof(hit));
+        GRFX_Batch_Put(scratch, ids, sizeof(ids));
+    }
+
+    // Records are written whole, in the order scenes finish
+    SDL_LockMutex(batch->lock);
+    fwrite(scratch->record, 1, scratch->record_size, batch->out);
+    SDL_UnlockMutex(batch->lock);
+}
+
+void GRFX_Batch_Put(struct GRFX_Batch_Scratch *scratch, const void *bytes, size_t size) {
+    if (scratch->record_size + size > scratch->record_capacity) {
+        scratch->record_capacity = (scratch->record_size + size) * 2;
+        scratch->record = realloc(scratch->record, scratch->record_capacity);
+    }
 
-int MAF_Distance(int x1, int y1, int x2, int y2 ) {
-    return (int)sqrt((double)(x2 - x1) * (x2 -x1) + (y2 - y1) * (y2 - y1));
+    memcpy(scratch->record + scratch->record_size, bytes, size);
+    scratch->record_size += size;
 }
 
-#pragma endregion MAF Def
\ No newline at end of file
+#pragma endregion Batch Def
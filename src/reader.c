@@ -0,0 +1,205 @@
+#pragma region Include
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL3/SDL.h>
+#include "grfx.h"
+
+#pragma endregion Include
+
+#pragma region Macro
+
+#define OPEN_TIMEOUT_MS 5000
+#define IDLE_TIMEOUT_MS 2000
+#define REPORT_MS 1000
+
+#pragma endregion Macro
+
+#pragma region Declare
+
+// What was read from the ring so far
+struct GRFX_Reader {
+    Uint32 read;
+    Uint32 dropped;
+    Uint32 torn;
+    Uint64 segments;
+    double energy;
+    double luma;
+};
+
+// Command line options
+struct GRFX_Reader_Options {
+    const char *name;
+    const char *dump_dir;
+    Uint32 frames;
+};
+
+// Parse command line options
+void GRFX_Reader_Args(int argc, char *argv[], struct GRFX_Reader_Options *options);
+
+// Map the ring, waiting for the writer to create it
+bool GRFX_Reader_Open(struct GRFX_Ring *ring, const char *name);
+
+// Sum a slot's segments and image where they lie, and copy the image out when copy is set.
+// Nothing is kept unless the slot turns out not to have changed meanwhile.
+SDL_Surface *GRFX_Reader_Frame(struct GRFX_Reader *reader, const struct GRFX_Ring *ring, const struct GRFX_Ring_Slot *slot, bool copy);
+
+#pragma endregion Declare
+
+int main(int argc, char *argv[]) {
+    struct GRFX_Reader_Options options;
+    struct GRFX_Reader reader = { 0 };
+    struct GRFX_Ring ring;
+
+    GRFX_Reader_Args(argc, argv, &options);
+
+    if (!GRFX_Reader_Open(&ring, options.name)) {
+        printf("Could not open %s: %s\n", options.name, SDL_GetError());
+        return 1;
+    }
+
+    // Start with the next frame the writer publishes
+    Uint32 next = GRFX_Ring_Frames(&ring);
+    Uint64 last_frame = SDL_GetTicks(), last_report = last_frame;
+
+    while (options.frames == 0 || reader.read < options.frames) {
+        Uint32 frames = GRFX_Ring_Frames(&ring);
+        Uint64 now = SDL_GetTicks();
+
+        if (next >= frames) {
+            // Nothing new for a while: the writer replaced the ring with a bigger one under the same name, or is gone
+            if (now - last_frame > IDLE_TIMEOUT_MS) {
+                // A ring still at the same frame is the old one, left behind by a writer that died
+                GRFX_Ring_Close(&ring);
+                if (!GRFX_Ring_Open(&ring, options.name) || GRFX_Ring_Frames(&ring) == frames) break;
+
+                next = GRFX_Ring_Frames(&ring);
+                last_frame = now;
+                continue;
+            }
+
+            SDL_Delay(1);
+            continue;
+        }
+
+        last_frame = now;
+        const struct GRFX_Ring_Slot *slot = GRFX_Ring_Read_Begin(&ring, next);
+
+        // Fell a whole ring behind: skip to the newest frame
+        if (slot == NULL) {
+            reader.dropped += frames - 1 - next;
+            next = frames - 1;
+            continue;
+        }
+
+        struct GRFX_Reader frame = reader;
+        SDL_Surface *image = GRFX_Reader_Frame(&frame, &ring, slot, options.dump_dir != NULL);
+
+        // The copy is only written once the slot is known to be whole
+        if (GRFX_Ring_Read_End(slot, next)) {
+            reader = frame;
+
+            if (image != NULL) {
+                char path[1024];
+                SDL_snprintf(path, sizeof(path), "%s/ring_%06u.bmp", options.dump_dir, next);
+                SDL_SaveBMP(image, path);
+            }
+        } else {
+            reader.torn++;
+        }
+
+        SDL_DestroySurface(image);
+
+        next++;
+
+        if (now - last_report >= REPORT_MS) {
+            printf("frame %u: read %u, dropped %u, torn %u, %.1f segments and %.2f luma per frame\n", next - 1, reader.read, reader.dropped,
+                reader.torn, reader.read ? (double)reader.segments / reader.read : 0, reader.read ? reader.luma / reader.read : 0);
+            last_report = now;
+        }
+    }
+
+    printf("Read %u frames (%u dropped, %u torn): %llu segments, total energy %.1f\n", reader.read, reader.dropped, reader.torn,
+        (unsigned long long)reader.segments, reader.energy);
+
+    GRFX_Ring_Close(&ring);
+
+    return 0;
+}
+
+#pragma region Reader Def
+
+void GRFX_Reader_Args(int argc, char *argv[], struct GRFX_Reader_Options *options) {
+    options->name = NULL;
+    options->dump_dir = NULL;
+    options->frames = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options->frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            options->dump_dir = argv[++i];
+        }
+        else if (options->name == NULL && argv[i][0] != '-') {
+            options->name = argv[i];
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if (options->name == NULL) {
+        printf("Usage: reader NAME [--frames N] [--dump DIR]\n");
+        exit(1);
+    }
+}
+
+bool GRFX_Reader_Open(struct GRFX_Ring *ring, const char *name) {
+    Uint64 start = SDL_GetTicks();
+
+    while (!GRFX_Ring_Open(ring, name)) {
+        if (SDL_GetTicks() - start > OPEN_TIMEOUT_MS) return false;
+        SDL_Delay(100);
+    }
+
+    return true;
+}
+
+SDL_Surface *GRFX_Reader_Frame(struct GRFX_Reader *reader, const struct GRFX_Ring *ring, const struct GRFX_Ring_Slot *slot, bool copy) {
+    const struct GRFX_Ray_Segment *segments = GRFX_Ring_Segments(slot);
+    const Uint8 *pixels = GRFX_Ring_Pixels(ring, slot);
+    const SDL_PixelFormatDetails *details = SDL_GetPixelFormatDetails(slot->format);
+
+    // A torn slot can hold any counts, keep them in bounds
+    Uint32 n = SDL_min(slot->num_segments, ring->header->max_segments);
+    Uint32 width = SDL_min(slot->width, ring->header->max_width), height = SDL_min(slot->height, ring->header->max_height);
+    Uint64 luma = 0;
+
+    // Images are in whatever 4 byte format the writer's renderer reads back
+    if (details == NULL || details->bytes_per_pixel != 4) width = height = 0;
+
+    for (Uint32 i = 0; i < n; i++) reader->energy += segments[i].energy;
+
+    for (Uint32 y = 0; y < height; y++) {
+        const Uint32 *row = (const Uint32 *)(pixels + y * width * 4);
+        for (Uint32 x = 0; x < width; x++) {
+            Uint8 r, g, b;
+            SDL_GetRGB(row[x], details, NULL, &r, &g, &b);
+            luma += (r * 299 + g * 587 + b * 114) / 1000;
+        }
+    }
+
+    SDL_Surface *image = copy && width > 0 && height > 0 ? SDL_CreateSurface(width, height, slot->format) : NULL;
+    if (image != NULL) SDL_ConvertPixels(width, height, slot->format, pixels, width * 4, image->format, image->pixels, image->pitch);
+
+    reader->read++;
+    reader->segments += n;
+    reader->luma += width * height > 0 ? (double)luma / (width * height) : 0;
+
+    return image;
+}
+
+#pragma endregion Reader Def